@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <omp.h>
+#include "permanent.h"
+
+/*
+ * Benchmark: table-driven (0,1) kernel vs the general kernels.
+ *
+ * 1. Single permanent / determinant of random (0,1) n x n matrices, n = 2..8
+ *    (general path: Spies Gray-code kernel and Bareiss).
+ * 2. The searcher workload: permanent_det_packed() on the leaves of the
+ *    sorted-row enumeration used by oeis_a089476 (n = 6, 7).
+ *
+ *   ./benchmark [seconds_per_case]
+ */
+
+#define SAMPLES 4096
+
+static double min_time = 0.2;
+static volatile double sink;
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+static uint64_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// Runs fn over the sample set until min_time has passed; returns ns per call.
+static double time_calls(double (*fn)(const int8_t*, int), const int8_t *mats, int n) {
+    long long calls = 0;
+    double start = omp_get_wtime(), elapsed;
+    do {
+        double acc = 0.0;
+        for (int s = 0; s < SAMPLES; s++) acc += fn(&mats[(size_t)s * n * n], n);
+        sink = acc;
+        calls += SAMPLES;
+        elapsed = omp_get_wtime() - start;
+    } while (elapsed < min_time);
+    return elapsed * 1e9 / (double)calls;
+}
+
+static double perm_square(const int8_t *A, int n) { return permanent(A, n, n); }
+static double det_square(const int8_t *A, int n) { return determinant(A, n); }
+
+// Leaves of the A089476 enumeration (rows non-decreasing), in DFS order.
+static long long collect_leaves(int n, int row, int start, uint64_t packed,
+                                uint64_t *out, long long cap, long long count) {
+    for (int val = start; val < (1 << n) && count < cap; val++) {
+        uint64_t next = packed | ((uint64_t)val << (8 * row));
+        if (row == n - 1) out[count++] = next;
+        else count = collect_leaves(n, row + 1, val, next, out, cap, count);
+    }
+    return count;
+}
+
+static double time_packed(const uint64_t *leaves, long long count, int n, double *perms, double *dets) {
+    long long done = 0;
+    double start = omp_get_wtime(), elapsed;
+    do {
+        for (long long i = 0; i < count; i += 4096) {
+            int len = (int)(count - i < 4096 ? count - i : 4096);
+            permanent_det_packed(&leaves[i], len, n, perms, dets);
+        }
+        done += count;
+        elapsed = omp_get_wtime() - start;
+    } while (elapsed < min_time);
+    return elapsed * 1e9 / (double)done;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) min_time = atof(argv[1]);
+    printf("--- Benchmark: table-driven (0,1) kernel (kernels: %s) ---\n", permanent_isa());
+
+    int8_t *mats = (int8_t*)malloc((size_t)SAMPLES * 64);
+    if (!mats) return 1;
+    for (size_t i = 0; i < (size_t)SAMPLES * 64; i++) mats[i] = (int8_t)(rng() & 1);
+
+    printf("\nSingle matrices (ns per call)\n");
+    printf("%3s %14s %14s %8s %14s %14s %8s\n", "n", "perm general", "perm table", "gain",
+           "det general", "det table", "gain");
+    for (int n = 2; n <= 8; n++) {
+        permanent_set_tables(0);
+        double pg = time_calls(perm_square, mats, n);
+        double dg = time_calls(det_square, mats, n);
+        permanent_set_tables(1);
+        double pt = time_calls(perm_square, mats, n);
+        double dt = time_calls(det_square, mats, n);
+        printf("%3d %14.1f %14.1f %7.1fx %14.1f %14.1f %7.1fx\n", n, pg, pt, pg / pt, dg, dt, dg / dt);
+    }
+    free(mats);
+
+    printf("\nSearcher workload: permanent_det_packed, sorted-row leaves (ns per leaf)\n");
+    printf("%3s %12s %14s %14s %8s\n", "n", "leaves", "general", "table", "gain");
+    const long long cap = 1 << 22;
+    uint64_t *leaves = (uint64_t*)malloc((size_t)cap * sizeof(uint64_t));
+    double *perms = (double*)malloc(4096 * sizeof(double));
+    double *dets = (double*)malloc(4096 * sizeof(double));
+    if (!leaves || !perms || !dets) return 1;
+    for (int n = 6; n <= 7; n++) {
+        long long count = collect_leaves(n, 0, 0, 0, leaves, cap, 0);
+        permanent_set_tables(0);
+        double g = time_packed(leaves, count, n, perms, dets);
+        permanent_set_tables(1);
+        double t = time_packed(leaves, count, n, perms, dets);
+        printf("%3d %12lld %14.2f %14.2f %7.1fx\n", n, count, g, t, g / t);
+    }
+    free(leaves); free(perms); free(dets);
+    return 0;
+}
@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <omp.h>
+#include "permanent.h"
+#include "search_engine.h"
+
+/*
+ * perm_search - configurable permanent-value search.
+ *
+ *   perm_search <config> [key=value ...]
+ *
+ * The config file holds key = value lines ('#' starts a comment); arguments
+ * of the form key=value override it. Keys:
+ *
+ *   n           matrix size
+ *   alphabet    binary | ternary            entries {0,1} or {-1,0,1}
+ *   symmetry    none | symmetric
+ *   predicate   any | singular | nonsingular
+ *   weight      any | k                     exactly k nonzero entries
+ *   aggregate   set | histogram | min | max | minmax
+ *   output      CSV file (optional)
+ *   enumerators, evaluators                 pipeline threads
+ *
+ * configs/a089475.cfg and configs/a089476.cfg run the same searches as
+ * oeis_a089475 and oeis_a089476 (both are thin wrappers over search_engine).
+ */
+
+typedef enum { AGG_SET, AGG_HISTOGRAM, AGG_MIN, AGG_MAX, AGG_MINMAX } Aggregate;
+
+typedef struct {
+    SearchSpec spec;
+    Aggregate aggregate;
+    char output[512];
+} Job;
+
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) s++;
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) *--end = '\0';
+    return s;
+}
+
+static int parse_int(const char *v, int *out) {
+    char *end;
+    long x = strtol(v, &end, 10);
+    if (*v == '\0' || *end != '\0') return -1;
+    *out = (int)x;
+    return 0;
+}
+
+// Applies one key/value pair; returns 0 or -1 for an unknown key or value.
+static int set_option(Job *job, const char *key, const char *value) {
+    SearchSpec *s = &job->spec;
+    if (strcmp(key, "n") == 0) return parse_int(value, &s->n);
+    if (strcmp(key, "enumerators") == 0) return parse_int(value, &s->enumerators);
+    if (strcmp(key, "evaluators") == 0) return parse_int(value, &s->evaluators);
+    if (strcmp(key, "alphabet") == 0) {
+        if (strcmp(value, "binary") == 0) s->alphabet = ALPHABET_BINARY;
+        else if (strcmp(value, "ternary") == 0) s->alphabet = ALPHABET_TERNARY;
+        else return -1;
+        return 0;
+    }
+    if (strcmp(key, "symmetry") == 0) {
+        if (strcmp(value, "none") == 0) s->symmetry = SYMMETRY_NONE;
+        else if (strcmp(value, "symmetric") == 0) s->symmetry = SYMMETRY_SYMMETRIC;
+        else return -1;
+        return 0;
+    }
+    if (strcmp(key, "predicate") == 0) {
+        if (strcmp(value, "any") == 0) s->det = DET_ANY;
+        else if (strcmp(value, "singular") == 0) s->det = DET_SINGULAR;
+        else if (strcmp(value, "nonsingular") == 0) s->det = DET_NONSINGULAR;
+        else return -1;
+        return 0;
+    }
+    if (strcmp(key, "weight") == 0) {
+        if (strcmp(value, "any") == 0) { s->weight = -1; return 0; }
+        return parse_int(value, &s->weight);
+    }
+    if (strcmp(key, "aggregate") == 0) {
+        if (strcmp(value, "set") == 0) job->aggregate = AGG_SET;
+        else if (strcmp(value, "histogram") == 0) job->aggregate = AGG_HISTOGRAM;
+        else if (strcmp(value, "min") == 0) job->aggregate = AGG_MIN;
+        else if (strcmp(value, "max") == 0) job->aggregate = AGG_MAX;
+        else if (strcmp(value, "minmax") == 0) job->aggregate = AGG_MINMAX;
+        else return -1;
+        return 0;
+    }
+    if (strcmp(key, "output") == 0) {
+        snprintf(job->output, sizeof(job->output), "%s", value);
+        return 0;
+    }
+    return -1;
+}
+
+// Parses "key = value"; blank lines and '#' comments are skipped.
+static int parse_line(Job *job, char *line, const char *where) {
+    char *hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+    char *s = trim(line);
+    if (*s == '\0') return 0;
+    char *eq = strchr(s, '=');
+    if (!eq) {
+        fprintf(stderr, "%s: expected key = value, got '%s'\n", where, s);
+        return -1;
+    }
+    *eq = '\0';
+    char *key = trim(s), *value = trim(eq + 1);
+    if (set_option(job, key, value) != 0) {
+        fprintf(stderr, "%s: bad option '%s = %s'\n", where, key, value);
+        return -1;
+    }
+    return 0;
+}
+
+static int load_config(Job *job, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) { perror(path); return -1; }
+    char line[1024], where[600];
+    int lineno = 0, rc = 0;
+    while (rc == 0 && fgets(line, sizeof(line), fp)) {
+        snprintf(where, sizeof(where), "%s:%d", path, ++lineno);
+        rc = parse_line(job, line, where);
+    }
+    fclose(fp);
+    return rc;
+}
+
+static const char *aggregate_name(Aggregate a) {
+    static const char *names[] = { "set", "histogram", "min", "max", "minmax" };
+    return names[a];
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <config> [key=value ...]\n", argv[0]);
+        return 1;
+    }
+
+    int threads = omp_get_max_threads();
+    Job job;
+    memset(&job, 0, sizeof(job));
+    job.spec.n = 4;
+    job.spec.weight = -1;
+    job.spec.enumerators = threads >= 4 ? threads / 4 : 1;
+    job.spec.evaluators = -1;       // default: the remaining threads
+    job.aggregate = AGG_SET;
+
+    if (load_config(&job, argv[1]) != 0) return 1;
+    for (int i = 2; i < argc; i++) {
+        char arg[1024];
+        snprintf(arg, sizeof(arg), "%s", argv[i]);
+        if (parse_line(&job, arg, "argument") != 0) return 1;
+    }
+    SearchSpec *spec = &job.spec;
+    if (spec->enumerators < 1) spec->enumerators = 1;
+    if (spec->evaluators < 0) spec->evaluators = threads > spec->enumerators ? threads - spec->enumerators : 0;
+    spec->values_only = job.aggregate == AGG_SET;
+
+    const char *err = search_spec_error(spec);
+    if (err) { fprintf(stderr, "Invalid search: %s\n", err); return 1; }
+
+    static const char *alphabets[] = { "binary", "ternary" };
+    static const char *symmetries[] = { "none", "symmetric" };
+    static const char *predicates[] = { "any", "singular", "nonsingular" };
+    printf("--- Permanent search: n=%d, %s, symmetry %s, predicate %s",
+           spec->n, alphabets[spec->alphabet], symmetries[spec->symmetry], predicates[spec->det]);
+    if (spec->weight >= 0) printf(", weight %d", spec->weight);
+    printf(", aggregate %s ---\n", aggregate_name(job.aggregate));
+    printf("Kernels: %s (override with PERMANENT_ISA)\n", permanent_isa());
+
+    double start_time = omp_get_wtime();
+    SearchResult res;
+    if (search_engine_run(spec, &res) != 0) {
+        fprintf(stderr, "Search failed (out of memory)\n");
+        return 1;
+    }
+    double end_time = omp_get_wtime();
+
+    FILE *fp = NULL;
+    if (job.output[0]) {
+        fp = fopen(job.output, "w");
+        if (!fp) perror(job.output);
+    }
+
+    long long distinct = 0, lo = 0, hi = -1;
+    for (long long i = 0; i < res.size; i++) {
+        if (!res.leaf_histogram[i]) continue;
+        if (!distinct) lo = i;
+        hi = i;
+        distinct++;
+    }
+
+    printf("\n--- Results ---\n");
+    if (job.aggregate == AGG_SET) {
+        printf("Values found: ");
+        for (long long i = 0; i < res.size; i++) {
+            if (!res.leaf_histogram[i]) continue;
+            printf("%lld ", i - res.offset);
+            if (fp) fprintf(fp, "%lld\n", i - res.offset);
+        }
+        printf("\nTotal distinct permanent values: %lld\n", distinct);
+    } else if (job.aggregate == AGG_HISTOGRAM) {
+        // Counts are per sorted row multiset (or per symmetric matrix), not per matrix.
+        const char *unit = spec->symmetry == SYMMETRY_SYMMETRIC ? "matrices" : "multisets";
+        printf("%12s %16s\n", "permanent", unit);
+        if (fp) fprintf(fp, "permanent,%s\n", unit);
+        for (long long i = 0; i < res.size; i++) {
+            if (!res.leaf_histogram[i]) continue;
+            printf("%12lld %16lld\n", i - res.offset, res.leaf_histogram[i]);
+            if (fp) fprintf(fp, "%lld,%lld\n", i - res.offset, res.leaf_histogram[i]);
+        }
+        printf("Total distinct permanent values: %lld\n", distinct);
+    } else if (distinct == 0) {
+        printf("No matrix passed the predicates\n");
+    } else {
+        if (job.aggregate != AGG_MAX) {
+            printf("Minimum permanent: %lld (%lld leaves)\n", lo - res.offset, res.leaf_histogram[lo]);
+            if (fp) fprintf(fp, "min,%lld,%lld\n", lo - res.offset, res.leaf_histogram[lo]);
+        }
+        if (job.aggregate != AGG_MIN) {
+            printf("Maximum permanent: %lld (%lld leaves)\n", hi - res.offset, res.leaf_histogram[hi]);
+            if (fp) fprintf(fp, "max,%lld,%lld\n", hi - res.offset, res.leaf_histogram[hi]);
+        }
+    }
+    if (fp) {
+        fclose(fp);
+        printf("CSV written to %s\n", job.output);
+    }
+
+    // Counts are per sorted row multiset (or per symmetric matrix), not per matrix.
+    printf("\nLeaves passing predicates: %lld (of %lld leaves)\n", res.matrices, res.leaves);
+    printf("Time elapsed: %.4f seconds\n", end_time - start_time);
+    PipelineConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.enumerators = spec->enumerators;
+    cfg.evaluators = spec->evaluators;
+    pipeline_print_stats(&cfg, &res.pipeline);
+    if (spec->det != DET_ANY) search_print_cascade(&res);
+
+    search_result_free(&res);
+    return 0;
+}
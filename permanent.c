@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <math.h>
+#include <time.h>
 #ifdef _OPENMP
 #  include <omp.h>
 #endif
@@ -31,11 +33,34 @@ static double binomial(int n, int k) {
 }
 
 
+// --- RUNTIME CPU DISPATCH (declarations) ---
+//
+// The hot kernels are written once as always-inline bodies and compiled
+// into one function per instruction set (see the end of this file). The
+// variant is picked when the library is loaded, so a binary built without
+// -march=native runs on old nodes and still uses AVX2 / AVX-512 where present.
+
+#define KERNEL_BODY static inline __attribute__((always_inline))
+
+struct perm_kernels {
+    const char *name;
+    double (*spies)(const int8_t *matrix_transposed, int n);
+    double (*ryser)(const int8_t *A, int m, int n);
+    double (*determinant)(const int8_t *A, int n);
+    void (*row_values)(const double *perm_minors, const double *cofactors, int n,
+                       int lo, int hi, double *perms, double *dets);
+    void (*packed_values)(const double *perm_minors, const double *cofactors, int n,
+                          const uint64_t *leaves, int count, double *perms, double *dets);
+    void (*minors)(const double *A, int n, uint64_t lo, uint64_t hi, double *G, double *work);
+};
+
+static const struct perm_kernels *active_kernels;
+
 // The Kernel: Spies' Algebraic Formula.
 // Assumes 'matrix_transposed' is stored as T = A_padded^T to allow sequential access,
 // drastically improving cache performance and enabling SIMD vectorization.
 
-static double fast_permanent_kernel(const int8_t *matrix_transposed, int n) {
+KERNEL_BODY double fast_permanent_kernel_body(const int8_t *matrix_transposed, int n) {
     // Guard against undefined behavior and degenerate cases
     if (n < 0) return 0.0;
     if (n == 0) return 1.0;
@@ -85,6 +110,319 @@ static double fast_permanent_kernel(const int8_t *matrix_transposed, int n) {
     return total / (double)num_loops;
 }
 
+static double fast_permanent_kernel(const int8_t *matrix_transposed, int n) {
+    return active_kernels->spies(matrix_transposed, n);
+}
+
+// --- MULTIPLICITY-AWARE RYSER ---
+//
+// A square n x n matrix B whose rows are k distinct lines L_1..L_k, line j
+// repeated mult[j] times (sum mult[j] = n), has
+//   perm(B) = (-1)^n Σ_{0 <= s_j <= mult_j} (-1)^{|s|} Π_j C(mult_j, s_j) Π_i (Σ_j s_j L_j[i])
+// which is Ryser's formula with equal rows grouped: Π (mult_j + 1) terms
+// instead of 2^n. Since perm(B) = perm(B^T), the same kernel handles
+// repeated columns when it is given the columns as lines.
+
+// Below this size permanent() does not look for repeated lines: the
+// Gray-code kernel is already cheaper than the detection.
+#define MULTIPLICITY_MIN_N 8
+
+// Required saving before permanent() switches kernels: the number of
+// multiplicity terms must be at most 2^(n-1) / MULTIPLICITY_GAIN.
+#define MULTIPLICITY_GAIN 4.0
+
+// Number of terms the multiplicity kernel visits.
+static double multiplicity_terms(const int *mult, int k) {
+    double terms = 1.0;
+    for (int j = 0; j < k; j++) terms *= (double)(mult[j] + 1);
+    return terms;
+}
+
+// 'lines' holds k vectors of length n (row-major). Every mult[j] must be >= 1.
+static double multiplicity_kernel(const int8_t *lines, const int *mult, int k, int n) {
+    if (n == 0) return 1.0;
+
+    int total_coef = 0;
+    for (int j = 0; j < k; j++) total_coef += mult[j] + 1;
+
+    int64_t *sums = (int64_t*)calloc((size_t)n, sizeof(int64_t));
+    double *coef = (double*)malloc((size_t)total_coef * sizeof(double));
+    int *coef_off = (int*)malloc((size_t)k * sizeof(int));
+    int *a = (int*)calloc((size_t)k, sizeof(int));       // current s_j
+    int *o = (int*)malloc((size_t)k * sizeof(int));      // direction of s_j
+    int *f = (int*)malloc((size_t)(k + 1) * sizeof(int)); // focus pointers
+    if (!sums || !coef || !coef_off || !a || !o || !f) {
+        free(sums); free(coef); free(coef_off); free(a); free(o); free(f);
+        return 0.0;
+    }
+
+    for (int j = 0, off = 0; j < k; j++) {
+        coef_off[j] = off;
+        for (int s = 0; s <= mult[j]; s++) coef[off + s] = binomial(mult[j], s);
+        off += mult[j] + 1;
+        o[j] = 1;
+        f[j] = j;
+    }
+    f[k] = k;
+
+    // Reflected mixed-radix Gray code (Knuth 7.2.1.1, Algorithm H):
+    // every step moves exactly one s_j by +-1.
+    double total = 0.0;
+    double sign = 1.0;
+    for (;;) {
+        double product = 1.0;
+        for (int i = 0; i < n; i++) product *= (double)sums[i];
+        if (product != 0.0) {
+            double w = 1.0;
+            for (int j = 0; j < k; j++) w *= coef[coef_off[j] + a[j]];
+            total += sign * w * product;
+        }
+
+        int j = f[0];
+        f[0] = 0;
+        if (j == k) break;
+
+        a[j] += o[j];
+        const int8_t *line = &lines[(size_t)j * (size_t)n];
+        int64_t step = o[j];
+        #pragma omp simd
+        for (int i = 0; i < n; i++) sums[i] += step * line[i];
+        sign = -sign;
+
+        if (a[j] == 0 || a[j] == mult[j]) {
+            o[j] = -o[j];
+            f[j] = f[j + 1];
+            f[j + 1] = j + 1;
+        }
+    }
+
+    free(sums); free(coef); free(coef_off); free(a); free(o); free(f);
+    return (n & 1) ? -total : total;
+}
+
+// Groups the rows (length n) of the rows x n matrix M into distinct lines.
+// On return rep[j] is the first row of group j and mult[j] its size.
+// Rows are hashed first so the common all-distinct case costs O(rows * n).
+static int group_lines(const int8_t *M, int rows, int n, int *rep, int *mult, uint64_t *hash) {
+    for (int r = 0; r < rows; r++) {
+        uint64_t h = 1469598103934665603ULL;            // FNV-1a
+        const int8_t *row = &M[(size_t)r * (size_t)n];
+        for (int c = 0; c < n; c++) {
+            h ^= (uint8_t)row[c];
+            h *= 1099511628211ULL;
+        }
+        hash[r] = h;
+    }
+
+    int k = 0;
+    for (int r = 0; r < rows; r++) {
+        const int8_t *row = &M[(size_t)r * (size_t)n];
+        int g = 0;
+        for (; g < k; g++) {
+            if (hash[rep[g]] == hash[r] &&
+                memcmp(&M[(size_t)rep[g] * (size_t)n], row, (size_t)n) == 0) break;
+        }
+        if (g == k) {
+            rep[k] = r;
+            mult[k] = 0;
+            k++;
+        }
+        mult[g]++;
+    }
+    return k;
+}
+
+// log2 Π_i Σ_j |M[i][j]| over the rows of the n x n matrix M (-inf for a zero row).
+static double log2_abs_row_product(const int8_t *M, int n) {
+    double bits = 0.0;
+    for (int i = 0; i < n; i++) {
+        int64_t sum = 0;
+        for (int j = 0; j < n; j++) sum += abs(M[(size_t)i * n + j]);
+        bits += log2((double)sum);
+    }
+    return bits;
+}
+
+// Tries the multiplicity kernel on the square matrix B (and its transpose BT).
+// Returns 1 and stores perm(B) in *res when the saving over the Gray-code
+// kernel is at least MULTIPLICITY_GAIN and the alternating sum cannot round:
+// grouping the rows, Σ |terms| <= 2^n Π (column sums of |b_ij|), and the
+// result is exact if that is at most 2^52 (rows and columns swap roles when
+// grouping the columns). Masschelein padding rows (sums n) never pass this
+// for n >= MULTIPLICITY_MIN_N, so rectangular inputs stay on Spies.
+static int try_multiplicity(const int8_t *B, const int8_t *BT, int n, double *res) {
+    int *rep_r = (int*)malloc((size_t)n * 4 * sizeof(int));
+    uint64_t *hash = (uint64_t*)malloc((size_t)n * sizeof(uint64_t));
+    if (!rep_r || !hash) { free(rep_r); free(hash); return 0; }
+    int *mult_r = rep_r + n, *rep_c = rep_r + 2 * n, *mult_c = rep_r + 3 * n;
+
+    int kr = group_lines(B, n, n, rep_r, mult_r, hash);
+    int kc = group_lines(BT, n, n, rep_c, mult_c, hash);
+    free(hash);
+
+    // Grouping rows sums over columns and vice versa; an inexact grouping is never used.
+    double terms_r = multiplicity_terms(mult_r, kr);
+    double terms_c = multiplicity_terms(mult_c, kc);
+    if (n + log2_abs_row_product(BT, n) > 52.0) terms_r = HUGE_VAL;
+    if (n + log2_abs_row_product(B, n) > 52.0) terms_c = HUGE_VAL;
+    int use_rows = terms_r <= terms_c;
+    double terms = use_rows ? terms_r : terms_c;
+    double gray_terms = (double)(1ULL << (n - 1));
+
+    int done = 0;
+    if (terms * MULTIPLICITY_GAIN <= gray_terms) {
+        const int8_t *src = use_rows ? B : BT;
+        const int *rep = use_rows ? rep_r : rep_c;
+        const int *mult = use_rows ? mult_r : mult_c;
+        int k = use_rows ? kr : kc;
+
+        int8_t *lines = (int8_t*)malloc((size_t)k * (size_t)n);
+        if (lines) {
+            for (int j = 0; j < k; j++)
+                memcpy(&lines[(size_t)j * n], &src[(size_t)rep[j] * n], (size_t)n);
+            *res = multiplicity_kernel(lines, mult, k, n);
+            free(lines);
+            done = 1;
+        }
+    }
+    free(rep_r);
+    return done;
+}
+
+// --- TABLE-DRIVEN LAPLACE KERNEL FOR SMALL (0,1) MATRICES ---
+//
+// Permanent and determinant of every k x k (0,1)-matrix, k <= 4, are stored
+// in tables indexed by the packed block (row r in bits [k*r, k*r + k)); the
+// 4 x 4 tables have 2^16 entries. An m x m matrix with 4 < m <= 8 is split
+// into its top t = m - 4 rows and bottom 4 rows; the generalized Laplace
+// expansion over the t-column subsets S,
+//   perm(A) = Σ_S perm(A[top, S]) perm(A[bottom, ~S]),
+//   det(A)  = Σ_S (-1)^(t(t-1)/2 + Σ_{j∈S} j) det(A[top, S]) det(A[bottom, ~S]),
+// then costs C(m, t) pairs of lookups (70 for m = 8) instead of a 2^(m-1)
+// step Gray-code pass. Rows are restricted to a column set with a byte
+// compress table (compress_tab[mask][byte] = PEXT(byte, mask)).
+// The tables are filled once, when the library is loaded.
+
+// Largest m for which permanent() and determinant() use the tables
+// (see benchmark.c: the lookups beat both kernels for every m <= 8).
+#define TABLE_MAX_N 8
+
+static uint8_t compress_tab[256][256];
+static uint8_t ptab0[1], ptab1[2], ptab2[16], ptab3[512], ptab4[1 << 16];
+static int8_t dtab0[1], dtab1[2], dtab2[16], dtab3[512], dtab4[1 << 16];
+static uint8_t *const perm_tab[5] = { ptab0, ptab1, ptab2, ptab3, ptab4 };
+static int8_t *const det_tab[5] = { dtab0, dtab1, dtab2, dtab3, dtab4 };
+
+// Top-row column subsets for m = 5..8 (t = m - 4 columns), with det signs.
+static uint8_t split_mask[9][70];
+static uint8_t split_odd[9][70];
+static int split_count[9];
+
+static int tables_enabled = 1;
+
+__attribute__((constructor))
+static void build_laplace_tables(void) {
+    for (int mask = 0; mask < 256; mask++) {
+        for (int byte = 0; byte < 256; byte++) {
+            int out = 0, pos = 0;
+            for (int b = 0; b < 8; b++)
+                if ((mask >> b) & 1) out |= ((byte >> b) & 1) << pos++;
+            compress_tab[mask][byte] = (uint8_t)out;
+        }
+    }
+
+    // k x k from (k-1) x (k-1): Laplace expansion along row 0.
+    ptab0[0] = 1;
+    dtab0[0] = 1;
+    for (int k = 1; k <= 4; k++) {
+        int full = (1 << k) - 1;
+        for (int idx = 0; idx < (1 << (k * k)); idx++) {
+            int p = 0, d = 0;
+            for (int j = 0; j < k; j++) {
+                if (!((idx >> j) & 1)) continue;
+                int cols = full & ~(1 << j), sub = 0;
+                for (int r = 1; r < k; r++)
+                    sub |= compress_tab[cols][(idx >> (k * r)) & full] << ((k - 1) * (r - 1));
+                p += perm_tab[k - 1][sub];
+                d += (j & 1) ? -det_tab[k - 1][sub] : det_tab[k - 1][sub];
+            }
+            perm_tab[k][idx] = (uint8_t)p;
+            det_tab[k][idx] = (int8_t)d;
+        }
+    }
+
+    for (int m = 5; m <= 8; m++) {
+        int t = m - 4, count = 0;
+        for (int S = 0; S < (1 << m); S++) {
+            if (__builtin_popcount(S) != t) continue;
+            int parity = t * (t - 1) / 2;
+            for (int j = 0; j < m; j++) if ((S >> j) & 1) parity += j;
+            split_mask[m][count] = (uint8_t)S;
+            split_odd[m][count] = (uint8_t)(parity & 1);
+            count++;
+        }
+        split_count[m] = count;
+    }
+}
+
+// Permanent and determinant of the m x m (0,1)-matrix whose row r is the
+// low m bits of rows[r] (m <= 8). Either output may be NULL.
+static inline void table_perm_det(const uint8_t *rows, int m, int64_t *perm, int64_t *det) {
+    if (m <= 4) {
+        int idx = 0;
+        for (int r = 0; r < m; r++) idx |= rows[r] << (m * r);
+        if (perm) *perm = perm_tab[m][idx];
+        if (det) *det = det_tab[m][idx];
+        return;
+    }
+    int t = m - 4, full = (1 << m) - 1;
+    const uint8_t *top_p = perm_tab[t];
+    const int8_t *top_d = det_tab[t];
+    int64_t p = 0, d = 0;
+    for (int s = 0; s < split_count[m]; s++) {
+        int S = split_mask[m][s], C = full ^ S;
+        int top = 0, bot = 0;
+        for (int r = 0; r < t; r++) top |= compress_tab[S][rows[r]] << (t * r);
+        for (int r = 0; r < 4; r++) bot |= compress_tab[C][rows[t + r]] << (4 * r);
+        p += top_p[top] * ptab4[bot];
+        if (det) {
+            int dd = top_d[top] * dtab4[bot];
+            d += split_odd[m][s] ? -dd : dd;
+        }
+    }
+    if (perm) *perm = p;
+    if (det) *det = d;
+}
+
+// Packs an m x n int8 matrix into rows of bits. Returns 0 if any entry is not 0 or 1.
+static inline int pack_binary_rows(const int8_t *A, int m, int n, uint8_t *rows) {
+    for (int r = 0; r < m; r++) {
+        int bits = 0;
+        for (int c = 0; c < n; c++) {
+            int8_t x = A[r * n + c];
+            if (x & ~1) return 0;
+            bits |= x << c;
+        }
+        rows[r] = (uint8_t)bits;
+    }
+    return 1;
+}
+
+// laplace_last_row() for the n-1 packed rows of an n x n (0,1)-matrix (n <= 8):
+// every minor is the rows compressed to the other n-1 columns.
+static void table_last_row(const uint8_t *rows, int n, double *perm_minors, double *cofactors) {
+    int k = n - 1, full = (1 << n) - 1;
+    uint8_t minor[8];
+    for (int j = 0; j < n; j++) {
+        int cols = full & ~(1 << j);
+        for (int r = 0; r < k; r++) minor[r] = compress_tab[cols][rows[r]];
+        int64_t p, d;
+        table_perm_det(minor, k, &p, cofactors ? &d : NULL);
+        if (perm_minors) perm_minors[j] = (double)p;
+        if (cofactors) cofactors[j] = ((k + j) & 1) ? -(double)d : (double)d;
+    }
+}
+
 // --- PUBLIC FUNCTIONS ---
 
 // 1. Permanent Calculation
@@ -102,6 +440,17 @@ double permanent(const int8_t *A, int m, int n) {
     }
 
     // From here on, we know m <= n.
+    // Small (0,1) matrices: table lookups (the padding rows are all ones).
+    if (tables_enabled && n <= TABLE_MAX_N) {
+        uint8_t rows[8];
+        if (pack_binary_rows(A, m, n, rows)) {
+            for (int r = m; r < n; r++) rows[r] = (uint8_t)((1 << n) - 1);
+            int64_t p;
+            table_perm_det(rows, n, &p, NULL);
+            return (n > m) ? (double)p / factorial(n - m) : (double)p;
+        }
+    }
+
     // We pad rows to match columns (Masschelein).
     int target_n = n; 
     int diff = n - m; // Number of rows to add
@@ -122,8 +471,22 @@ double permanent(const int8_t *A, int m, int n) {
         }
     }
 
-    // 3. Calculate
-    double res = fast_permanent_kernel(padded_transposed, target_n);
+    // 3. Calculate.
+    // Repeated rows or columns can make the multiplicity-aware Ryser sum much
+    // shorter than the Gray-code pass (only where it provably cannot round).
+    double res;
+    int done = 0;
+    if (target_n >= MULTIPLICITY_MIN_N && target_n <= 63) {
+        int8_t *padded = (int8_t*)malloc(target_n * target_n * sizeof(int8_t));
+        if (padded) {
+            for (int r = 0; r < target_n; r++)
+                for (int c = 0; c < target_n; c++)
+                    padded[r * target_n + c] = padded_transposed[c * target_n + r];
+            done = try_multiplicity(padded, padded_transposed, target_n, &res);
+            free(padded);
+        }
+    }
+    if (!done) res = fast_permanent_kernel(padded_transposed, target_n);
     free(padded_transposed);
 
     // 4. Normalize
@@ -135,8 +498,7 @@ double permanent(const int8_t *A, int m, int n) {
 }
 
 // 2. Exact Determinant (Bareiss)
-double determinant(const int8_t *A, int n) {
-    if (n == 0) return 1.0;
+KERNEL_BODY double determinant_body(const int8_t *A, int n) {
     int64_t *M = (int64_t*)malloc(n * n * sizeof(int64_t));
     if (!M) return 0.0;
     for (int i = 0; i < n * n; i++) M[i] = (int64_t)A[i];
@@ -172,6 +534,19 @@ double determinant(const int8_t *A, int n) {
     return (double)(result * sign);
 }
 
+double determinant(const int8_t *A, int n) {
+    if (n == 0) return 1.0;
+    if (tables_enabled && n <= TABLE_MAX_N) {
+        uint8_t rows[8];
+        int64_t d;
+        if (pack_binary_rows(A, n, n, rows)) {
+            table_perm_det(rows, n, NULL, &d);
+            return (double)d;
+        }
+    }
+    return active_kernels->determinant(A, n);
+}
+
 // 3.  Ryser's Algorithm (Rectangular m x n)
 // Modernized port of Spies (2006) code.
 double permanent_ryser(const int8_t *A, int m, int n) {
@@ -283,15 +658,7 @@ static inline double binom_int(int n, int k) {
     return r;
 }
 
-double ryser_new(const int8_t *A, int m, int n) {
-    if (m < 0 || n < 0) return 0.0;
-    if (m == 0) return 1.0;
-    if (m > n) return 0.0;
-    if (!A) return 0.0;
-
-    if (n == 0) return 0.0;
-    if (n > 62) return 0.0;   // shifts safe; praktisch sowieso onhaalbaar
-
+KERNEL_BODY double ryser_new_body(const int8_t *A, int m, int n) {
     int64_t *row_sums = (int64_t*)calloc((size_t)m, sizeof(int64_t));
     if (!row_sums) return 0.0;
 
@@ -333,3 +700,1720 @@ double ryser_new(const int8_t *A, int m, int n) {
     return total;
 }
 
+double ryser_new(const int8_t *A, int m, int n) {
+    if (m < 0 || n < 0) return 0.0;
+    if (m == 0) return 1.0;
+    if (m > n) return 0.0;
+    if (!A) return 0.0;
+
+    if (n == 0) return 0.0;
+    if (n > 62) return 0.0;   // shifts safe; praktisch sowieso onhaalbaar
+
+    return active_kernels->ryser(A, m, n);
+}
+
+
+
+// 5. Multiplicity-aware permanent
+// R holds k rows of length n; row j stands for mult[j] equal rows of A.
+// With m = sum mult[j] <= n, the n - m padding rows of ones (Masschelein)
+// form one more group, so the Ryser sum has Π (mult_j + 1) * (n - m + 1) terms.
+double permanent_multiplicity(const int8_t *R, const int *mult, int k, int n) {
+    if (k < 0 || n < 0) return 0.0;
+    if (k > 0 && (!R || !mult)) return 0.0;
+
+    int m = 0;
+    for (int j = 0; j < k; j++) {
+        if (mult[j] < 0) return 0.0;
+        m += mult[j];
+    }
+    if (m == 0) return 1.0;
+    if (m > n) return 0.0;
+
+    int diff = n - m;
+    int8_t *lines = (int8_t*)malloc((size_t)(k + 1) * (size_t)n);
+    int *gmult = (int*)malloc((size_t)(k + 1) * sizeof(int));
+    if (!lines || !gmult) { free(lines); free(gmult); return 0.0; }
+
+    int g = 0;
+    for (int j = 0; j < k; j++) {
+        if (mult[j] == 0) continue;
+        memcpy(&lines[(size_t)g * n], &R[(size_t)j * n], (size_t)n);
+        gmult[g++] = mult[j];
+    }
+    if (diff > 0) {
+        memset(&lines[(size_t)g * n], 1, (size_t)n);
+        gmult[g++] = diff;
+    }
+
+    double res = multiplicity_kernel(lines, gmult, g, n);
+    free(lines);
+    free(gmult);
+
+    if (diff > 0) res /= factorial(diff);
+    return res;
+}
+
+
+// 6. Laplace expansion along the last row
+// A holds the first n-1 rows of an n x n matrix. Deleting column j leaves an
+// (n-1) x (n-1) minor; its permanent and signed determinant are the
+// coefficients of x_j in perm and det of [A; x], both linear in x.
+void laplace_last_row(const int8_t *A, int n, double *perm_minors, double *cofactors) {
+    if (n <= 0 || !A) return;
+    int k = n - 1;
+    uint8_t rows[8];
+    if (tables_enabled && n <= TABLE_MAX_N && pack_binary_rows(A, k, n, rows)) {
+        table_last_row(rows, n, perm_minors, cofactors);
+        return;
+    }
+    // Minors up to 8 x 8 (n <= 9) fit on the stack; larger ones are allocated
+    // and, if that fails, the outputs are zeroed rather than left undefined.
+    int8_t stack_minor[64];
+    int8_t *minor = stack_minor;
+    if (k * k > (int)sizeof(stack_minor)) {
+        minor = (int8_t*)malloc((size_t)k * k * sizeof(int8_t));
+        if (!minor) {
+            for (int j = 0; j < n; j++) {
+                if (perm_minors) perm_minors[j] = 0.0;
+                if (cofactors) cofactors[j] = 0.0;
+            }
+            return;
+        }
+    }
+
+    for (int j = 0; j < n; j++) {
+        for (int r = 0; r < k; r++) {
+            int c2 = 0;
+            for (int c = 0; c < n; c++) {
+                if (c != j) minor[r * k + c2++] = A[r * n + c];
+            }
+        }
+        if (perm_minors) perm_minors[j] = permanent(minor, k, k);
+        if (cofactors) {
+            double d = determinant(minor, k);
+            cofactors[j] = ((k + j) & 1) ? -d : d;
+        }
+    }
+    if (minor != stack_minor) free(minor);
+}
+
+
+// 7. Last-row candidate values
+// For every val in [lo, hi) the bits of val form the last row x; writes
+// perms[val - lo] = Σ x_j perm_minors[j] and dets[val - lo] = Σ x_j cofactors[j].
+// The loop over val is innermost so it vectorizes.
+KERNEL_BODY void laplace_row_values_body(const double *perm_minors, const double *cofactors,
+                                         int n, int lo, int hi, double *perms, double *dets) {
+    int count = hi - lo;
+    for (int v = 0; v < count; v++) { perms[v] = 0.0; dets[v] = 0.0; }
+    for (int b = 0; b < n; b++) {
+        double pm = perm_minors[b], cf = cofactors[b];
+        #pragma omp simd
+        for (int v = 0; v < count; v++) {
+            double bit = (double)(((lo + v) >> b) & 1);
+            perms[v] += bit * pm;
+            dets[v] += bit * cf;
+        }
+    }
+}
+
+void laplace_row_values(const double *perm_minors, const double *cofactors, int n,
+                        int lo, int hi, double *perms, double *dets) {
+    if (n <= 0 || hi <= lo || !perm_minors || !cofactors || !perms || !dets) return;
+    active_kernels->row_values(perm_minors, cofactors, n, lo, hi, perms, dets);
+}
+
+// 8. Batched evaluation of bit-packed (0,1)-matrices
+// Leaf k holds row r in byte r. A run of leaves that share rows 0..n-2 needs
+// one laplace_last_row() call; the last rows (top byte) are then evaluated
+// together, with the loop over leaves innermost so it vectorizes.
+KERNEL_BODY void packed_values_body(const double *perm_minors, const double *cofactors, int n,
+                                    const uint64_t *leaves, int count, double *perms, double *dets) {
+    int shift = 8 * (n - 1);
+    for (int v = 0; v < count; v++) { perms[v] = 0.0; dets[v] = 0.0; }
+    for (int b = 0; b < n; b++) {
+        double pm = perm_minors[b], cf = cofactors[b];
+        #pragma omp simd
+        for (int v = 0; v < count; v++) {
+            double bit = (double)((leaves[v] >> (shift + b)) & 1);
+            perms[v] += bit * pm;
+            dets[v] += bit * cf;
+        }
+    }
+}
+
+// Nonzero if one of the low k bytes of w equals b (SWAR zero-byte test).
+static inline uint64_t repeats_byte(uint64_t w, unsigned b, int k) {
+    uint64_t x = w ^ (0x0101010101010101ULL * b);
+    uint64_t low = k >= 8 ? ~0ULL : (1ULL << (8 * k)) - 1;
+    return (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL & low;
+}
+
+// Singularity cascade per run of leaves, cheapest exact test first:
+//   1. a zero or repeated row among rows 0..n-2: every leaf is singular and
+//      only the permanent minors are computed;
+//   2. rows 0..n-2 of lower rank: every cofactor is 0;
+//   3. otherwise det = Σ cofactors over the last row's bits.
+void permanent_det_packed_stats(const uint64_t *leaves, int count, int n, double *perms,
+                                double *dets, SingularityStats *stats) {
+    if (!leaves || !perms || !dets || count <= 0 || n < 1 || n > 8) return;
+    uint64_t parent_mask = (n == 1) ? 0 : (~0ULL >> (64 - 8 * (n - 1)));
+    int8_t A[7 * 8];
+    double pm[8], cf[8];
+    SingularityStats st;
+    memset(&st, 0, sizeof(st));
+
+    int i = 0;
+    while (i < count) {
+        uint64_t parent = leaves[i] & parent_mask;
+        int j = i + 1;
+        while (j < count && (leaves[j] & parent_mask) == parent) j++;
+
+        uint8_t rows[8];
+        int dead = n > 1 && repeats_byte(parent, 0, n - 1) != 0;
+        for (int r = 0; r < n - 1; r++) {
+            rows[r] = (uint8_t)(parent >> (8 * r));
+            dead |= repeats_byte(parent, rows[r], r) != 0;
+        }
+        double *cofactors = dead ? NULL : cf;
+        if (dead) memset(cf, 0, sizeof(cf));
+
+        if (tables_enabled) {
+            table_last_row(rows, n, pm, cofactors);
+        } else {
+            for (int r = 0; r < n - 1; r++)
+                for (int c = 0; c < n; c++) A[r * n + c] = (int8_t)((rows[r] >> c) & 1);
+            laplace_last_row(A, n, pm, cofactors);
+        }
+        active_kernels->packed_values(pm, cf, n, &leaves[i], j - i, &perms[i], &dets[i]);
+
+        if (stats) {
+            int rank_deficient = 1;
+            for (int c = 0; c < n; c++) rank_deficient &= cf[c] == 0.0;
+            st.parents++;
+            if (dead) st.parent_structural += j - i;
+            else if (rank_deficient) st.parent_rank += j - i;
+            else st.leaf_exact += j - i;
+        }
+        i = j;
+    }
+    if (stats) {
+        stats->leaves += count;
+        stats->parents += st.parents;
+        stats->parent_structural += st.parent_structural;
+        stats->parent_rank += st.parent_rank;
+        stats->leaf_exact += st.leaf_exact;
+    }
+}
+
+void permanent_det_packed(const uint64_t *leaves, int count, int n, double *perms, double *dets) {
+    permanent_det_packed_stats(leaves, count, n, perms, dets, NULL);
+}
+
+// 9. Partial Spies sums over a Gray-code index range (exact, modular)
+//
+// The Spies kernel visits Gray indices i = 0 .. 2^(n-1)-1 and adds
+//   (-1)^i Π_r s_r(gray(i)),   s_r(g) = Σ_c a_rc (1 - 2 bit_c(g)),
+// so any index range can start directly from gray(lo). Partial sums are kept
+// modulo primes just below 2^62 (sums of two residues fit in 64 bits), which
+// makes them exact for any n and lets independent jobs be summed later.
+
+static const uint64_t residue_primes[PERM_MAX_RESIDUES] = {
+    4611686018427387847ULL, 4611686018427387817ULL, 4611686018427387787ULL,
+    4611686018427387761ULL, 4611686018427387751ULL, 4611686018427387737ULL,
+    4611686018427387733ULL, 4611686018427387709ULL, 4611686018427387701ULL,
+    4611686018427387631ULL, 4611686018427387617ULL, 4611686018427387587ULL,
+    4611686018427387461ULL, 4611686018427387421ULL, 4611686018427387409ULL,
+    4611686018427387329ULL
+};
+
+uint64_t permanent_residue_prime(int i) {
+    return (i >= 0 && i < PERM_MAX_RESIDUES) ? residue_primes[i] : 0;
+}
+
+int permanent_residue_count(const int8_t *A, int n) {
+    if (!A || n <= 0) return 1;
+    // |perm(A)| <= Π_r Σ_c |a_rc|; residues must cover twice that (sign).
+    int bits = 2;
+    for (int r = 0; r < n; r++) {
+        uint64_t row_abs = 0;
+        for (int c = 0; c < n; c++) {
+            int v = A[r * n + c];
+            row_abs += (uint64_t)(v < 0 ? -v : v);
+        }
+        if (row_abs > 1) bits += 64 - __builtin_clzll(row_abs - 1);
+    }
+    return (bits + 60) / 61;    // every prime exceeds 2^61
+}
+
+static inline uint64_t mulmod_u64(uint64_t a, uint64_t b, uint64_t p) {
+    return (uint64_t)(((unsigned __int128)a * b) % p);
+}
+
+// Montgomery product a * b * 2^-64 mod p (p odd, p < 2^62, a, b < p).
+// A product of n factors picks up 2^(-64(n-1)), the same for every Gray
+// index, so it is undone once per range instead of once per step.
+static inline uint64_t mont_mul(uint64_t a, uint64_t b, uint64_t p, uint64_t p_neg_inv) {
+    unsigned __int128 t = (unsigned __int128)a * b;
+    uint64_t m = (uint64_t)t * p_neg_inv;
+    uint64_t r = (uint64_t)((t + (unsigned __int128)m * p) >> 64);
+    return r >= p ? r - p : r;
+}
+
+// One thread's share: indices [lo, hi), written to res[0..count-1].
+// Entries are int32 so the wide permanent_i16/_i32 share this kernel.
+static void gray_range_chunk(const int32_t *A, int n, uint64_t lo, uint64_t hi,
+                             int count, uint64_t *res) {
+    int64_t row_sums[64];
+    uint64_t p_neg_inv[PERM_MAX_RESIDUES];
+    uint64_t g = lo ^ (lo >> 1);
+
+    for (int r = 0; r < n; r++) {
+        int64_t s = 0;
+        for (int c = 0; c < n; c++) {
+            int64_t a = A[r * n + c];
+            s += ((g >> c) & 1) ? -a : a;
+        }
+        row_sums[r] = s;
+    }
+
+    for (int j = 0; j < count; j++) {
+        uint64_t p = residue_primes[j], x = p;    // Newton: x = p^-1 mod 2^64
+        for (int it = 0; it < 5; it++) x *= 2 - p * x;
+        p_neg_inv[j] = -x;
+        res[j] = 0;
+    }
+
+    for (uint64_t i = lo; i < hi; i++) {
+        int negative = (int)(i & 1);
+        for (int j = 0; j < count; j++) {
+            uint64_t p = residue_primes[j];
+            // |row sum| <= 63 * 2^31, far below p
+            uint64_t prod = row_sums[0] < 0 ? (uint64_t)(row_sums[0] + (int64_t)p) : (uint64_t)row_sums[0];
+            for (int r = 1; r < n; r++) {
+                int64_t s = row_sums[r];
+                prod = mont_mul(prod, s < 0 ? (uint64_t)(s + (int64_t)p) : (uint64_t)s, p, p_neg_inv[j]);
+            }
+            if (negative && prod) prod = p - prod;
+            res[j] += prod;
+            if (res[j] >= p) res[j] -= p;
+        }
+
+        // Step to gray(i + 1): one column flips sign.
+        uint64_t next = (i + 1) ^ ((i + 1) >> 1);
+        int col = __builtin_ctzll(next ^ g);
+        int64_t direction = (next > g) ? -2 : 2;
+        for (int r = 0; r < n; r++) row_sums[r] += direction * A[r * n + col];
+        g = next;
+    }
+
+    // Undo the Montgomery factor 2^(-64(n-1)).
+    for (int j = 0; j < count; j++) {
+        uint64_t p = residue_primes[j];
+        uint64_t r64 = (uint64_t)(((unsigned __int128)1 << 64) % p);
+        uint64_t f = 1;
+        for (int r = 1; r < n; r++) f = mulmod_u64(f, r64, p);
+        res[j] = mulmod_u64(res[j], f, p);
+    }
+}
+
+// Residues of the Gray sum over [lo, hi), OpenMP-split. Returns 0 or -1 (out of memory).
+static int gray_range_residues(const int32_t *A, int n, uint64_t lo, uint64_t hi,
+                               int count, uint64_t *residues) {
+    for (int j = 0; j < count; j++) residues[j] = 0;
+    if (lo == hi) return 0;
+
+    int nthreads = 1;
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+    if ((uint64_t)nthreads > hi - lo) nthreads = (int)(hi - lo);
+#endif
+    uint64_t *partial = (uint64_t*)calloc((size_t)nthreads * (size_t)count, sizeof(uint64_t));
+    if (!partial) return -1;
+
+    // Each thread starts its own slice directly from gray(a).
+    uint64_t span = hi - lo;
+    uint64_t base = span / (uint64_t)nthreads, extra = span % (uint64_t)nthreads;
+    #pragma omp parallel for num_threads(nthreads) schedule(static, 1)
+    for (int t = 0; t < nthreads; t++) {
+        uint64_t ut = (uint64_t)t;
+        uint64_t a = lo + base * ut + (ut < extra ? ut : extra);
+        uint64_t b = a + base + (ut < extra ? 1 : 0);
+        gray_range_chunk(A, n, a, b, count, &partial[(size_t)t * count]);
+    }
+
+    for (int t = 0; t < nthreads; t++) {
+        for (int j = 0; j < count; j++) {
+            residues[j] += partial[(size_t)t * count + j];
+            if (residues[j] >= residue_primes[j]) residues[j] -= residue_primes[j];
+        }
+    }
+    free(partial);
+    return 0;
+}
+
+int permanent_gray_range(const int8_t *A, int n, uint64_t lo, uint64_t hi,
+                         int count, uint64_t *residues) {
+    if (!A || !residues || n < 1 || n > 63) return -1;
+    if (count < 1 || count > PERM_MAX_RESIDUES) return -1;
+    uint64_t total = 1ULL << (n - 1);
+    if (lo > hi || hi > total) return -1;
+
+    int32_t *W = (int32_t*)malloc((size_t)n * (size_t)n * sizeof(int32_t));
+    if (!W) return -1;
+    for (int i = 0; i < n * n; i++) W[i] = A[i];
+    int rc = gray_range_residues(W, n, lo, hi, count, residues);
+    free(W);
+    return rc;
+}
+
+// 10. Table-driven kernel switch
+// On by default; permanent_set_tables(0) restores the Gray-code / Bareiss
+// kernels for small (0,1) matrices (used by benchmark.c and the tests).
+int permanent_set_tables(int enabled) {
+    int previous = tables_enabled;
+    tables_enabled = enabled != 0;
+    return previous;
+}
+
+// 11. All minor permanents (the gradient) in one Gray-code pass
+//
+// With s_r(δ) = Σ_c δ_c a_rc, δ ∈ {±1}^n, δ_{n-1} = +1 (Glynn / Spies),
+//   perm(A)   = 2^-(n-1) Σ_δ (Π δ) Π_r s_r,
+//   ∂perm/∂a_ij = perm(A without row i, column j)
+//             = 2^-(n-1) Σ_δ (Π δ) δ_j Π_{r≠i} s_r.
+// The products without row i come from prefix and suffix products (no
+// division, zeros are fine). δ_j only changes when column j flips, so the
+// running sums C_i of the signed products give Σ δ_j Π_{r≠i} s_r over the
+// steps since the last flip of j as δ_j (C_i - C_i at that flip): a flip
+// settles one column for all rows in O(n), and a step stays O(n).
+KERNEL_BODY void minors_chunk_body(const double *A, int n, uint64_t lo, uint64_t hi,
+                                   double *G, double *work) {
+    double *s = work, *pre = s + n, *C = pre + n, *snap = C + n;
+    uint64_t g = lo ^ (lo >> 1);
+
+    for (int r = 0; r < n; r++) {
+        double sum = 0.0;
+        for (int c = 0; c < n; c++) sum += ((g >> c) & 1) ? -A[r * n + c] : A[r * n + c];
+        s[r] = sum;
+        C[r] = 0.0;
+    }
+    for (int i = 0; i < n * n; i++) snap[i] = 0.0;
+
+    for (uint64_t i = lo; i < hi; i++) {
+        double p = (i & 1) ? -1.0 : 1.0;
+        for (int r = 0; r < n; r++) { pre[r] = p; p *= s[r]; }
+        double q = 1.0;
+        for (int r = n - 1; r >= 0; r--) { C[r] += pre[r] * q; q *= s[r]; }
+        if (i + 1 == hi) break;
+
+        // Step to gray(i + 1): column col flips from d to -d.
+        uint64_t next = (i + 1) ^ ((i + 1) >> 1);
+        int col = __builtin_ctzll(next ^ g);
+        double d = ((g >> col) & 1) ? -1.0 : 1.0;
+        double *sn = &snap[col * n];
+        for (int r = 0; r < n; r++) {
+            G[r * n + col] += d * (C[r] - sn[r]);
+            sn[r] = C[r];
+        }
+        #pragma omp simd
+        for (int r = 0; r < n; r++) s[r] -= 2.0 * d * A[r * n + col];
+        g = next;
+    }
+
+    for (int j = 0; j < n; j++) {
+        double d = ((g >> j) & 1) ? -1.0 : 1.0;
+        for (int r = 0; r < n; r++) G[r * n + j] += d * (C[r] - snap[j * n + r]);
+    }
+}
+
+// Below this many Gray steps per thread the pass runs single-threaded.
+#define MINORS_STEPS_PER_THREAD 4096
+
+double permanent_minors_d(const double *A, int n, double *minors) {
+    if (n == 0) return 1.0;
+    if (!A || !minors || n < 0 || n > 63) return 0.0;
+    uint64_t total = 1ULL << (n - 1);
+
+    int nthreads = 1;
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+    if ((uint64_t)nthreads > total / MINORS_STEPS_PER_THREAD)
+        nthreads = (int)(total / MINORS_STEPS_PER_THREAD);
+    if (nthreads < 1) nthreads = 1;
+#endif
+    size_t nn = (size_t)n * (size_t)n, per_thread = 2 * nn + 3 * (size_t)n;
+    double *buf = (double*)calloc((size_t)nthreads * per_thread, sizeof(double));
+    if (!buf) return 0.0;
+
+    // Each thread starts its own slice directly from gray(a).
+    uint64_t base = total / (uint64_t)nthreads, extra = total % (uint64_t)nthreads;
+    #pragma omp parallel for num_threads(nthreads) schedule(static, 1)
+    for (int t = 0; t < nthreads; t++) {
+        uint64_t ut = (uint64_t)t;
+        uint64_t a = base * ut + (ut < extra ? ut : extra);
+        uint64_t b = a + base + (ut < extra ? 1 : 0);
+        double *G = &buf[(size_t)t * per_thread];
+        active_kernels->minors(A, n, a, b, G, G + nn);
+    }
+
+    double scale = 1.0 / (double)total;
+    for (size_t k = 0; k < nn; k++) {
+        double sum = 0.0;
+        for (int t = 0; t < nthreads; t++) sum += buf[(size_t)t * per_thread + k];
+        minors[k] = sum * scale;
+    }
+    free(buf);
+
+    // perm(A) by expansion along row 0.
+    double perm = 0.0;
+    for (int j = 0; j < n; j++) perm += A[j] * minors[j];
+    return perm;
+}
+
+double permanent_minors(const int8_t *A, int n, double *minors) {
+    if (n == 0) return 1.0;
+    if (!A || !minors || n < 0 || n > 63) return 0.0;
+    double *D = (double*)malloc((size_t)n * (size_t)n * sizeof(double));
+    if (!D) return 0.0;
+    for (int i = 0; i < n * n; i++) D[i] = (double)A[i];
+    double perm = permanent_minors_d(D, n, minors);
+    free(D);
+    return perm;
+}
+
+// 12. Approximate permanent of a nonnegative matrix
+//
+// Sinkhorn scaling B = diag(x) A diag(y), B doubly stochastic, gives
+//   perm(A) = perm(B) / (Π x_i Π y_j),  n!/n^n <= perm(B) <= 1
+// (van der Waerden / row sums). perm(B) is then estimated by sequential
+// importance sampling: row i picks a free column j with probability
+// b_ij / w_i, w_i = Σ_{free j} b_ij, and the sample is X = Π_i w_i
+// (0 at a dead end). E[X] = perm(B) exactly; scaling first keeps the
+// variance low. Samples are kept in log form (per-thread running maximum),
+// so large n neither overflows nor underflows.
+
+#define APPROX_SINKHORN_TOL 1e-12
+#define APPROX_SINKHORN_ITERS 10000
+#define APPROX_MIN_SAMPLES 2048
+#define APPROX_ROUND 1024           // samples per thread between stopping checks
+#define APPROX_DEFAULT_MAX 100000000LL
+
+typedef struct {
+    _Alignas(64) double m;          // running maximum of log X
+    double s1, s2;                  // Σ e^(log X - m), Σ e^(2 (log X - m))
+    long long count;
+} ApproxAcc;
+
+static inline uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline void acc_add(ApproxAcc *a, double logx) {
+    a->count++;
+    if (logx == -INFINITY) return;
+    if (logx > a->m) {
+        double f = (a->m == -INFINITY) ? 0.0 : exp(a->m - logx);
+        a->s1 *= f;
+        a->s2 *= f * f;
+        a->m = logx;
+    }
+    double e = exp(logx - a->m);
+    a->s1 += e;
+    a->s2 += e * e;
+}
+
+static void acc_merge(ApproxAcc *into, const ApproxAcc *a) {
+    into->count += a->count;
+    if (a->m == -INFINITY) return;
+    if (a->m > into->m) {
+        double f = (into->m == -INFINITY) ? 0.0 : exp(into->m - a->m);
+        into->s1 *= f;
+        into->s2 *= f * f;
+        into->m = a->m;
+    }
+    double f = exp(a->m - into->m);
+    into->s1 += a->s1 * f;
+    into->s2 += a->s2 * f * f;
+}
+
+// One importance sample of perm(B); returns log X (-inf at a dead end).
+static double approx_sample(const double *B, int n, int *cols, uint64_t *rng) {
+    for (int k = 0; k < n; k++) cols[k] = k;
+    double logx = 0.0;
+    for (int i = 0, free_cols = n; i < n; i++, free_cols--) {
+        const double *row = &B[(size_t)i * n];
+        double w = 0.0;
+        for (int k = 0; k < free_cols; k++) w += row[cols[k]];
+        if (!(w > 0.0)) return -INFINITY;
+        logx += log(w);
+
+        double u = (double)(splitmix64(rng) >> 11) * 0x1.0p-53 * w;
+        int k = 0;
+        for (double c = row[cols[0]]; k < free_cols - 1 && c <= u; ) c += row[cols[++k]];
+        while (row[cols[k]] == 0.0) k--;        // rounding at the upper end
+        cols[k] = cols[free_cols - 1];
+    }
+    return logx;
+}
+
+// Augmenting path from row i (Kuhn); match_col[j] = row matched to column j.
+static int approx_augment(const double *A, int n, int i, int *match_col, char *seen) {
+    for (int j = 0; j < n; j++) {
+        if (A[(size_t)i * n + j] == 0.0 || seen[j]) continue;
+        seen[j] = 1;
+        if (match_col[j] < 0 || approx_augment(A, n, match_col[j], match_col, seen)) {
+            match_col[j] = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 1 if the zero pattern of A has a perfect matching (perm(A) > 0), 0 if not,
+// -1 out of memory.
+static int approx_has_matching(const double *A, int n) {
+    int *match_col = (int*)malloc((size_t)n * sizeof(int));
+    char *seen = (char*)malloc((size_t)n);
+    if (!match_col || !seen) { free(match_col); free(seen); return -1; }
+    for (int j = 0; j < n; j++) match_col[j] = -1;
+    int ok = 1;
+    for (int i = 0; i < n && ok; i++) {
+        memset(seen, 0, (size_t)n);
+        ok = approx_augment(A, n, i, match_col, seen);
+    }
+    free(match_col); free(seen);
+    return ok;
+}
+
+// Normal quantile: z with P(|Z| <= z) = confidence (bisection on erfc).
+static double normal_half_quantile(double confidence) {
+    double lo = 0.0, hi = 40.0;
+    for (int it = 0; it < 200; it++) {
+        double mid = 0.5 * (lo + hi);
+        if (erfc(mid / sqrt(2.0)) > 1.0 - confidence) lo = mid;
+        else hi = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+
+int permanent_approx(const double *A, int n, double rel_err, double confidence,
+                     long long max_samples, uint64_t seed, PermanentApprox *out) {
+    if (!A || !out || n < 1 || !(rel_err > 0.0) || !(confidence > 0.0 && confidence < 1.0)) return -1;
+    for (size_t i = 0; i < (size_t)n * n; i++) if (!(A[i] >= 0.0) || isinf(A[i])) return -1;
+    if (max_samples <= 0) max_samples = APPROX_DEFAULT_MAX;
+    memset(out, 0, sizeof(*out));
+
+    // Row and column sums: upper bounds, and exact 0 for an empty line.
+    double *x = (double*)malloc((size_t)n * 3 * sizeof(double));
+    double *B = (double*)malloc((size_t)n * n * sizeof(double));
+    if (!x || !B) { free(x); free(B); return -1; }
+    double *y = x + n, *csum = y + n;
+    double log_rows = 0.0, log_cols = 0.0, log_bregman = 0.0;
+    int binary = 1, empty = 0;
+    for (int j = 0; j < n; j++) csum[j] = 0.0;
+    for (int i = 0; i < n; i++) {
+        double r = 0.0;
+        for (int j = 0; j < n; j++) {
+            double a = A[(size_t)i * n + j];
+            r += a;
+            csum[j] += a;
+            if (a != 0.0 && a != 1.0) binary = 0;
+        }
+        if (r == 0.0) empty = 1;
+        log_rows += log(r);
+        log_bregman += lgamma(r + 1.0) / r;     // Brègman: Π (r_i!)^(1/r_i) for (0,1)
+    }
+    for (int j = 0; j < n; j++) {
+        if (csum[j] == 0.0) empty = 1;
+        log_cols += log(csum[j]);
+    }
+    // No perfect matching: perm(A) = 0 exactly (Sinkhorn would not converge).
+    int matching = empty ? 0 : approx_has_matching(A, n);
+    if (matching < 0) { free(x); free(B); return -1; }
+    if (!matching) {
+        free(x); free(B);
+        out->log_estimate = out->log_lower = out->log_upper = -INFINITY;
+        out->converged = 1;
+        return 0;
+    }
+    double log_upper = log_rows < log_cols ? log_rows : log_cols;
+    if (binary && log_bregman < log_upper) log_upper = log_bregman;
+
+    // Sinkhorn: alternate row and column normalization.
+    for (int j = 0; j < n; j++) y[j] = 1.0;
+    double err = INFINITY;
+    int iter = 0;
+    for (; iter < APPROX_SINKHORN_ITERS && err > APPROX_SINKHORN_TOL; iter++) {
+        for (int i = 0; i < n; i++) {
+            double s = 0.0;
+            for (int j = 0; j < n; j++) s += A[(size_t)i * n + j] * y[j];
+            x[i] = 1.0 / s;
+        }
+        for (int j = 0; j < n; j++) csum[j] = 0.0;
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++) csum[j] += A[(size_t)i * n + j] * x[i];
+        err = 0.0;
+        for (int j = 0; j < n; j++) {
+            double c = csum[j] * y[j];
+            if (fabs(c - 1.0) > err) err = fabs(c - 1.0);
+            y[j] = 1.0 / csum[j];
+        }
+    }
+    // Rows of B sum to 1 exactly; columns to 1 within err.
+    double log_scale = 0.0, log_colsum_b = 0.0;
+    for (int j = 0; j < n; j++) csum[j] = 0.0;
+    for (int i = 0; i < n; i++) {
+        double s = 0.0;
+        for (int j = 0; j < n; j++) s += A[(size_t)i * n + j] * y[j];
+        x[i] = 1.0 / s;
+        for (int j = 0; j < n; j++) {
+            B[(size_t)i * n + j] = A[(size_t)i * n + j] * x[i] * y[j];
+            csum[j] += B[(size_t)i * n + j];
+        }
+        log_scale -= log(x[i]);
+    }
+    for (int j = 0; j < n; j++) { log_scale -= log(y[j]); log_colsum_b += log(csum[j]); }
+
+    // Without total support the scalings drift towards 0 and inf: then
+    // sample A itself (still unbiased) and keep only the unscaled bounds.
+    int scaled = err <= 1e-9 && isfinite(log_scale) && isfinite(log_colsum_b);
+    if (!isfinite(log_scale) || !isfinite(log_colsum_b)) {
+        memcpy(B, A, (size_t)n * n * sizeof(double));
+        log_scale = 0.0;
+    }
+    if (scaled && log_colsum_b + log_scale < log_upper) log_upper = log_colsum_b + log_scale;
+    out->log_upper = log_upper;
+    out->log_lower = scaled ? lgamma(n + 1.0) - n * log((double)n) + log_scale : -INFINITY;
+    out->sinkhorn_iterations = iter;
+
+    // Importance sampling in rounds until the CLT half-width meets rel_err.
+    double z = normal_half_quantile(confidence);
+    int nthreads = 1;
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+#endif
+    ApproxAcc *acc = (ApproxAcc*)aligned_alloc(64, (size_t)nthreads * sizeof(ApproxAcc));
+    int *cols = (int*)malloc((size_t)nthreads * n * sizeof(int));
+    uint64_t *rng = (uint64_t*)malloc((size_t)nthreads * sizeof(uint64_t));
+    if (!acc || !cols || !rng) { free(acc); free(cols); free(rng); free(x); free(B); return -1; }
+    for (int t = 0; t < nthreads; t++) {
+        acc[t].m = -INFINITY; acc[t].s1 = acc[t].s2 = 0.0; acc[t].count = 0;
+        rng[t] = seed ^ (0xD1B54A32D192ED03ULL * (uint64_t)(t + 1));
+    }
+
+    ApproxAcc total = { .m = -INFINITY };
+    double rel = INFINITY;
+    while (total.count < max_samples) {
+        long long left = max_samples - total.count;
+        long long per = (left + nthreads - 1) / nthreads;
+        if (per > APPROX_ROUND) per = APPROX_ROUND;
+
+        #pragma omp parallel for num_threads(nthreads) schedule(static, 1)
+        for (int t = 0; t < nthreads; t++) {
+            ApproxAcc local = { .m = -INFINITY };
+            for (long long s = 0; s < per; s++)
+                acc_add(&local, approx_sample(B, n, &cols[(size_t)t * n], &rng[t]));
+            acc[t] = local;
+        }
+        int live = 0;
+        for (int t = 0; t < nthreads; t++) {
+            live |= acc[t].m != -INFINITY;
+            acc_merge(&total, &acc[t]);
+        }
+        if (!live) break;                       // only dead ends: give up
+
+        double N = (double)total.count;
+        if (total.s1 > 0.0 && total.count > 1) {
+            double cv2 = N * total.s2 / (total.s1 * total.s1) - 1.0;
+            rel = z * sqrt((cv2 > 0.0 ? cv2 : 0.0) / (N - 1.0));
+        }
+        if (total.count >= APPROX_MIN_SAMPLES && rel <= rel_err) break;
+    }
+
+    out->samples = total.count;
+    if (total.s1 > 0.0) {
+        out->log_estimate = total.m + log(total.s1 / (double)total.count) + log_scale;
+        out->rel_half_width = rel;
+    } else {
+        out->log_estimate = -INFINITY;
+        out->rel_half_width = INFINITY;
+    }
+    out->estimate = exp(out->log_estimate);
+    out->half_width = out->rel_half_width * out->estimate;
+    out->lower_bound = exp(out->log_lower);
+    out->upper_bound = exp(out->log_upper);
+    out->converged = scaled && rel <= rel_err;
+
+    free(acc); free(cols); free(rng); free(x); free(B);
+    return 0;
+}
+
+// 13. Wider entry types (int16 / int32)
+//
+// permanent, ryser_new and determinant for int16_t and int32_t entries, all
+// generated from the macros below. The accumulator follows from a bound
+// computed in O(n^2):
+// - Gray / Ryser sums: every term is at most Π_r R_r (R_r = Σ_c |a_rc|),
+//   times the number of terms (and the Ryser binomial weight);
+// - Bareiss: every intermediate is a minor, |minor| <= H (Hadamard bound
+//   Π_r ||row_r||), and one update forms products of two of them.
+// Work below 2^62: int64; below 2^126: __int128; otherwise residues modulo
+// the primes of section 9 with CRT (exact values up to ~900 bits, rounded
+// once to double); beyond that double arithmetic (not exact).
+
+enum wide_acc { WIDE_INT64, WIDE_INT128, WIDE_MODULAR, WIDE_DOUBLE };
+
+// work_bits: bound on every partial sum; value_bits: bound on the result.
+static enum wide_acc wide_acc_for(double work_bits, double value_bits) {
+    if (work_bits < 62.0) return WIDE_INT64;
+    if (work_bits < 126.0) return WIDE_INT128;
+    if (value_bits < 61.0 * (PERM_MAX_RESIDUES - 1) - 1.0) return WIDE_MODULAR;
+    return WIDE_DOUBLE;
+}
+
+// Garner (below) needs |x| < product of all primes but the last.
+static int wide_prime_count(double value_bits) {
+    return (int)ceil((value_bits + 1.0) / 61.0) + 1;
+}
+
+static uint64_t powmod_u64(uint64_t a, uint64_t e, uint64_t p) {
+    uint64_t r = 1;
+    for (a %= p; e; e >>= 1) {
+        if (e & 1) r = mulmod_u64(r, a, p);
+        a = mulmod_u64(a, a, p);
+    }
+    return r;
+}
+
+// Signed x from residues modulo residue_primes[0..count-1]: Garner gives the
+// mixed-radix digits of x mod M (M = Π p_i), built exactly in 64-bit limbs;
+// the representative in (-M/2, M/2] is taken, so |x| < M/2 is required
+// (permanent_residue_count and wide_prime_count both leave that margin).
+// Stores |x| in limb[0..*used-1] (little-endian) and returns 1 if x < 0.
+static int crt_abs_limbs(const uint64_t *res, int count, uint64_t *limb, int *used) {
+    uint64_t v[PERM_MAX_RESIDUES] = {0};
+    for (int k = 0; k < count; k++) {
+        uint64_t p = residue_primes[k], t = res[k] % p;
+        for (int i = 0; i < k; i++) {
+            uint64_t vi = v[i] % p;
+            t = (t >= vi) ? t - vi : t + p - vi;
+            t = mulmod_u64(t, powmod_u64(residue_primes[i] % p, p - 2, p), p);
+        }
+        v[k] = t;
+    }
+
+    // x = Σ v_k Π_{i<k} p_i and M, Horner from the top digit.
+    uint64_t m[PERM_MAX_RESIDUES + 1] = {0};
+    int len = PERM_MAX_RESIDUES + 1;
+    for (int i = 0; i < len; i++) limb[i] = 0;
+    m[0] = 1;
+    for (int k = count - 1; k >= 0; k--) {
+        unsigned __int128 carry = v[k];
+        for (int i = 0; i < len; i++) {
+            unsigned __int128 t = (unsigned __int128)limb[i] * residue_primes[k] + carry;
+            limb[i] = (uint64_t)t;
+            carry = t >> 64;
+        }
+    }
+    for (int k = 0; k < count; k++) {
+        unsigned __int128 carry = 0;
+        for (int i = 0; i < len; i++) {
+            unsigned __int128 t = (unsigned __int128)m[i] * residue_primes[k] + carry;
+            m[i] = (uint64_t)t;
+            carry = t >> 64;
+        }
+    }
+
+    // x > M/2 (M is odd): x is negative and |x| = M - x.
+    int negative = 0;
+    for (int i = len - 1; i >= 0; i--) {
+        uint64_t half = (m[i] >> 1) | (i + 1 < len ? m[i + 1] << 63 : 0);
+        if (limb[i] != half) { negative = limb[i] > half; break; }
+    }
+    if (negative) {
+        uint64_t borrow = 0;
+        for (int i = 0; i < len; i++) {
+            uint64_t d = m[i] - limb[i] - borrow;
+            borrow = (m[i] < limb[i]) || (m[i] - limb[i] < borrow);
+            limb[i] = d;
+        }
+    }
+    *used = len;
+    while (*used > 1 && limb[*used - 1] == 0) (*used)--;
+    return negative;
+}
+
+// Signed value from residues modulo residue_primes[0..count-1], rounded once
+// to double: the top 64 bits of |x| (plus a sticky bit for the rest) are
+// converted.
+static double crt_to_double(const uint64_t *res, int count) {
+    uint64_t limb[PERM_MAX_RESIDUES + 1];
+    int used;
+    int negative = crt_abs_limbs(res, count, limb, &used);
+
+    int hi = used - 1, lz = __builtin_clzll(limb[hi] | 1);
+    uint64_t top = limb[hi], sticky = 0;
+    if (hi > 0) {
+        if (lz) top = (top << lz) | (limb[hi - 1] >> (64 - lz));
+        sticky = lz ? (limb[hi - 1] << lz) != 0 : limb[hi - 1] != 0;
+        for (int i = 0; i < hi - 1; i++) sticky |= limb[i] != 0;
+    } else {
+        lz = 0;
+    }
+    double x = ldexp((double)(top | sticky), 64 * hi - lz);
+    return negative ? -x : x;
+}
+
+int permanent_residue_decimal(const uint64_t *residues, int count, int n, char *buf, size_t size) {
+    if (!residues || !buf || count < 1 || count > PERM_MAX_RESIDUES || n < 1 || n > 64) return -1;
+
+    // Divide the Gray sum by 2^(n-1) (every prime is odd).
+    uint64_t r[PERM_MAX_RESIDUES];
+    for (int j = 0; j < count; j++) {
+        uint64_t p = residue_primes[j];
+        r[j] = mulmod_u64(residues[j] % p, powmod_u64((p + 1) / 2, (uint64_t)(n - 1), p), p);
+    }
+
+    uint64_t limb[PERM_MAX_RESIDUES + 1];
+    int used;
+    int negative = crt_abs_limbs(r, count, limb, &used);
+
+    // Base 10^19 digits, least significant first (< 64 bits * 17 / 63 of them).
+    uint64_t chunk[20];
+    int k = 0;
+    do {
+        unsigned __int128 rem = 0;
+        for (int i = used - 1; i >= 0; i--) {
+            unsigned __int128 cur = (rem << 64) | limb[i];
+            limb[i] = (uint64_t)(cur / 10000000000000000000ULL);
+            rem = cur % 10000000000000000000ULL;
+        }
+        chunk[k++] = (uint64_t)rem;
+        while (used > 1 && limb[used - 1] == 0) used--;
+    } while (used > 1 || limb[0] != 0);
+
+    int len = snprintf(buf, size, "%s%llu", negative ? "-" : "", (unsigned long long)chunk[k - 1]);
+    for (int i = k - 2; i >= 0 && len >= 0 && (size_t)len < size; i--)
+        len += snprintf(buf + len, size - (size_t)len, "%019llu", (unsigned long long)chunk[i]);
+    return (len >= 0 && (size_t)len < size) ? 0 : -1;
+}
+
+// Determinant modulo p (Gaussian elimination, Fermat inverses); M: n*n scratch.
+static uint64_t det_mod_p(const int32_t *A, int n, uint64_t p, uint64_t *M) {
+    for (int i = 0; i < n * n; i++) M[i] = A[i] < 0 ? p - (uint64_t)(-(int64_t)A[i]) : (uint64_t)A[i];
+    uint64_t det = 1;
+    for (int k = 0; k < n; k++) {
+        int piv = k;
+        while (piv < n && M[piv * n + k] == 0) piv++;
+        if (piv == n) return 0;
+        if (piv != k) {
+            for (int c = 0; c < n; c++) {
+                uint64_t t = M[k * n + c]; M[k * n + c] = M[piv * n + c]; M[piv * n + c] = t;
+            }
+            det = p - det;
+        }
+        det = mulmod_u64(det, M[k * n + k], p);
+        uint64_t inv = powmod_u64(M[k * n + k], p - 2, p);
+        for (int i = k + 1; i < n; i++) {
+            uint64_t f = mulmod_u64(M[i * n + k], inv, p);
+            if (!f) continue;
+            for (int c = k; c < n; c++)
+                M[i * n + c] = (M[i * n + c] + p - mulmod_u64(f, M[k * n + c], p)) % p;
+        }
+    }
+    return det % p;
+}
+
+// Exact C(n, k) for n <= 62.
+static int64_t binom_exact(int n, int k) {
+    if (k < 0 || k > n) return 0;
+    if (k > n - k) k = n - k;
+    unsigned __int128 r = 1;
+    for (int i = 1; i <= k; i++) r = r * (unsigned)(n - i + 1) / (unsigned)i;
+    return (int64_t)r;
+}
+
+// Spies / Gray sum Σ (-1)^i Π_r s_r(gray(i)) / 2^(n-1) over a square T matrix.
+#define DEFINE_SPIES_WIDE(NAME, T, ACC)                                           \
+    static ACC NAME(const T *A, int n) {                                          \
+        int64_t s[64];                                                            \
+        for (int r = 0; r < n; r++) {                                             \
+            s[r] = 0;                                                             \
+            for (int c = 0; c < n; c++) s[r] += A[r * n + c];                     \
+        }                                                                         \
+        ACC total = 0;                                                            \
+        uint64_t loops = 1ULL << (n - 1), g = 0;                                  \
+        for (uint64_t i = 0; i < loops; i++) {                                    \
+            ACC prod = 1;                                                         \
+            for (int r = 0; r < n; r++) prod *= (ACC)s[r];                        \
+            total += (i & 1) ? -prod : prod;                                      \
+            uint64_t next = (i + 1) ^ ((i + 1) >> 1);                             \
+            int col = __builtin_ctzll(next ^ g);                                  \
+            int64_t dir = (next > g) ? -2 : 2;                                    \
+            for (int r = 0; r < n; r++) s[r] += dir * A[r * n + col];             \
+            g = next;                                                             \
+        }                                                                         \
+        return total / (ACC)loops;                                                \
+    }
+
+// Rectangular Ryser (as ryser_new_body) with exact binomial weights.
+#define DEFINE_RYSER_WIDE(NAME, T, ACC)                                           \
+    static ACC NAME(const T *A, int m, int n) {                                   \
+        int64_t s[64] = {0};                                                      \
+        ACC total = 0;                                                            \
+        uint64_t old_gray = 0;                                                    \
+        for (uint64_t i = 1; i < (1ULL << n); i++) {                              \
+            uint64_t gray = i ^ (i >> 1), bit = gray ^ old_gray;                  \
+            int col = __builtin_ctzll(bit);                                       \
+            int64_t delta = (gray & bit) ? 1 : -1;                                \
+            for (int r = 0; r < m; r++) s[r] += delta * A[r * n + col];           \
+            int k = __builtin_popcountll(gray);                                   \
+            if (k <= m) {                                                         \
+                ACC w = (ACC)binom_exact(n - k, m - k);                           \
+                if ((m - k) & 1) w = -w;                                          \
+                ACC prod = 1;                                                     \
+                for (int r = 0; r < m; r++) prod *= (ACC)s[r];                    \
+                total += w * prod;                                                \
+            }                                                                     \
+            old_gray = gray;                                                      \
+        }                                                                         \
+        return total;                                                             \
+    }
+
+// Bareiss on a copy in M (n*n ACC scratch); exact while 2 H^2 fits ACC.
+#define DEFINE_BAREISS_WIDE(NAME, T, ACC)                                         \
+    static ACC NAME(const T *A, int n, ACC *M) {                                  \
+        for (int i = 0; i < n * n; i++) M[i] = (ACC)A[i];                         \
+        ACC sign = 1, prev = 1;                                                   \
+        for (int k = 0; k < n - 1; k++) {                                         \
+            if (M[k * n + k] == 0) {                                              \
+                int r = k + 1;                                                    \
+                while (r < n && M[r * n + k] == 0) r++;                           \
+                if (r == n) return 0;                                             \
+                for (int c = 0; c < n; c++) {                                     \
+                    ACC t = M[k * n + c]; M[k * n + c] = M[r * n + c]; M[r * n + c] = t; \
+                }                                                                 \
+                sign = -sign;                                                     \
+            }                                                                     \
+            ACC pivot = M[k * n + k];                                             \
+            for (int i = k + 1; i < n; i++)                                       \
+                for (int j = k + 1; j < n; j++)                                   \
+                    M[i * n + j] = (M[i * n + j] * pivot - M[i * n + k] * M[k * n + j]) / prev; \
+            prev = pivot;                                                         \
+        }                                                                         \
+        return sign * M[n * n - 1];                                               \
+    }
+
+// Gaussian elimination with partial pivoting (inexact fallback).
+#define DEFINE_GAUSS_WIDE(NAME, T)                                                \
+    static double NAME(const T *A, int n, long double *M) {                       \
+        for (int i = 0; i < n * n; i++) M[i] = A[i];                              \
+        long double det = 1.0L;                                                   \
+        for (int k = 0; k < n; k++) {                                             \
+            int piv = k;                                                          \
+            for (int r = k + 1; r < n; r++)                                       \
+                if (fabsl(M[r * n + k]) > fabsl(M[piv * n + k])) piv = r;         \
+            if (M[piv * n + k] == 0.0L) return 0.0;                               \
+            if (piv != k) {                                                       \
+                for (int c = 0; c < n; c++) {                                     \
+                    long double t = M[k * n + c]; M[k * n + c] = M[piv * n + c]; M[piv * n + c] = t; \
+                }                                                                 \
+                det = -det;                                                       \
+            }                                                                     \
+            det *= M[k * n + k];                                                  \
+            for (int i = k + 1; i < n; i++) {                                     \
+                long double f = M[i * n + k] / M[k * n + k];                      \
+                for (int c = k; c < n; c++) M[i * n + c] -= f * M[k * n + c];     \
+            }                                                                     \
+        }                                                                         \
+        return (double)det;                                                       \
+    }
+
+// The public functions for one entry type.
+#define DEFINE_WIDE_API(SUF, T)                                                   \
+    DEFINE_SPIES_WIDE(spies_##SUF##_i64, T, int64_t)                              \
+    DEFINE_SPIES_WIDE(spies_##SUF##_i128, T, __int128)                            \
+    DEFINE_SPIES_WIDE(spies_##SUF##_dbl, T, double)                               \
+    DEFINE_RYSER_WIDE(ryser_##SUF##_i64, T, int64_t)                              \
+    DEFINE_RYSER_WIDE(ryser_##SUF##_i128, T, __int128)                            \
+    DEFINE_BAREISS_WIDE(bareiss_##SUF##_i64, T, int64_t)                          \
+    DEFINE_BAREISS_WIDE(bareiss_##SUF##_i128, T, __int128)                        \
+    DEFINE_GAUSS_WIDE(gauss_##SUF, T)                                             \
+                                                                                  \
+    /* log2 of Σ_c |a_rc| summed over rows 0..m-1 (-1 if a row is zero). */      \
+    static double row_bits_##SUF(const T *A, int m, int n) {                      \
+        double bits = 0.0;                                                        \
+        for (int r = 0; r < m; r++) {                                             \
+            double sum = 0.0;                                                     \
+            for (int c = 0; c < n; c++) sum += fabs((double)A[r * n + c]);        \
+            if (sum == 0.0) return -1.0;                                          \
+            bits += log2(sum);                                                    \
+        }                                                                         \
+        return bits;                                                              \
+    }                                                                             \
+                                                                                  \
+    /* int8 copy of A if every entry fits (NULL otherwise or out of memory). */   \
+    static int8_t *narrow_##SUF(const T *A, int count) {                          \
+        for (int i = 0; i < count; i++) if (A[i] < -128 || A[i] > 127) return NULL; \
+        int8_t *B = (int8_t*)malloc((size_t)count);                               \
+        if (B) for (int i = 0; i < count; i++) B[i] = (int8_t)A[i];               \
+        return B;                                                                 \
+    }                                                                             \
+                                                                                  \
+    double permanent_##SUF(const T *A, int m, int n) {                            \
+        if (m < 0 || n < 0) return 0.0;                                           \
+        if (m == 0) return 1.0;                                                   \
+        if (!A || m > n || n > 63) return 0.0;                                    \
+        double value_bits = row_bits_##SUF(A, m, n);                              \
+        if (value_bits < 0.0) return 0.0;                                         \
+        value_bits += (n - m) * log2((double)n);    /* padding rows of ones */    \
+        /* Below 2^53 the int8 kernels (double sums, tables, ISA dispatch) are exact. */ \
+        int8_t *B8 = value_bits + (n - 1) < 53.0 ? narrow_##SUF(A, m * n) : NULL; \
+        if (B8) {                                                                 \
+            double res8 = permanent(B8, m, n);                                    \
+            free(B8);                                                             \
+            return res8;                                                          \
+        }                                                                         \
+        T *P = (T*)malloc((size_t)n * (size_t)n * sizeof(T));                     \
+        if (!P) return 0.0;                                                       \
+        for (int i = 0; i < n * n; i++) P[i] = (i < m * n) ? A[i] : 1;            \
+                                                                                  \
+        double res = 0.0;                                                         \
+        switch (wide_acc_for(value_bits + (n - 1), value_bits)) {                 \
+        case WIDE_INT64: {          /* bound < 2^62 implies (n-m)! < 2^62 */     \
+            int64_t f = 1;                                                        \
+            for (int i = 2; i <= n - m; i++) f *= i;                              \
+            res = (double)(spies_##SUF##_i64(P, n) / f);                          \
+            break;                                                                \
+        }                                                                         \
+        case WIDE_INT128: {                                                       \
+            __int128 f = 1;                                                       \
+            for (int i = 2; i <= n - m; i++) f *= i;                              \
+            res = (double)(spies_##SUF##_i128(P, n) / f);                         \
+            break;                                                                \
+        }                                                                         \
+        case WIDE_MODULAR: {                                                      \
+            int count = wide_prime_count(value_bits);                             \
+            uint64_t residues[PERM_MAX_RESIDUES];                                 \
+            int32_t *W = (int32_t*)malloc((size_t)n * (size_t)n * sizeof(int32_t)); \
+            int rc = -1;                                                          \
+            if (W) {                                                              \
+                for (int i = 0; i < n * n; i++) W[i] = P[i];                      \
+                rc = gray_range_residues(W, n, 0, 1ULL << (n - 1), count, residues); \
+                free(W);                                                          \
+            }                                                                     \
+            if (rc != 0) { free(P); return 0.0; }                                 \
+            for (int j = 0; j < count; j++) {                                     \
+                uint64_t p = residue_primes[j], d = powmod_u64(2, (uint64_t)(n - 1), p); \
+                for (int i = 2; i <= n - m; i++) d = mulmod_u64(d, (uint64_t)i, p); \
+                residues[j] = mulmod_u64(residues[j], powmod_u64(d, p - 2, p), p); \
+            }                                                                     \
+            res = crt_to_double(residues, count);                                 \
+            break;                                                                \
+        }                                                                         \
+        case WIDE_DOUBLE:                                                         \
+            res = spies_##SUF##_dbl(P, n) / factorial(n - m);                     \
+            break;                                                                \
+        }                                                                         \
+        free(P);                                                                  \
+        return res;                                                               \
+    }                                                                             \
+                                                                                  \
+    double ryser_new_##SUF(const T *A, int m, int n) {                            \
+        if (m < 0 || n < 0) return 0.0;                                           \
+        if (m == 0) return 1.0;                                                   \
+        if (!A || m > n || n == 0 || n > 62) return 0.0;                          \
+        double value_bits = row_bits_##SUF(A, m, n);                              \
+        if (value_bits < 0.0) return 0.0;                                         \
+        double weight_bits = 0.0;                                                 \
+        for (int k = 0; k <= m; k++) {                                            \
+            double b = log2((double)binom_exact(n - k, m - k));                   \
+            if (b > weight_bits) weight_bits = b;                                 \
+        }                                                                         \
+        int8_t *B8 = value_bits + weight_bits + n < 53.0 ? narrow_##SUF(A, m * n) : NULL; \
+        if (B8) {                                                                 \
+            double res8 = ryser_new(B8, m, n);                                    \
+            free(B8);                                                             \
+            return res8;                                                          \
+        }                                                                         \
+        switch (wide_acc_for(value_bits + weight_bits + n, value_bits)) {         \
+        case WIDE_INT64:  return (double)ryser_##SUF##_i64(A, m, n);              \
+        case WIDE_INT128: return (double)ryser_##SUF##_i128(A, m, n);             \
+        default:          return permanent_##SUF(A, m, n);  /* same value */      \
+        }                                                                         \
+    }                                                                             \
+                                                                                  \
+    double determinant_##SUF(const T *A, int n) {                                 \
+        if (n == 0) return 1.0;                                                   \
+        if (!A || n < 0) return 0.0;                                              \
+        double h_bits = 0.0;                          /* log2 Hadamard bound */   \
+        for (int r = 0; r < n; r++) {                                             \
+            double sq = 0.0;                                                      \
+            for (int c = 0; c < n; c++) sq += (double)A[r * n + c] * (double)A[r * n + c]; \
+            if (sq == 0.0) return 0.0;                                            \
+            h_bits += 0.5 * log2(sq);                                             \
+        }                                                                         \
+        enum wide_acc acc = wide_acc_for(2.0 * h_bits + 1.0, h_bits);             \
+        int8_t *B8 = acc == WIDE_INT64 ? narrow_##SUF(A, n * n) : NULL;           \
+        if (B8) {                        /* int8 Bareiss is int64 as well */      \
+            double res8 = determinant(B8, n);                                     \
+            free(B8);                                                             \
+            return res8;                                                          \
+        }                                                                         \
+        double res = 0.0;                                                         \
+        if (acc == WIDE_INT64 || acc == WIDE_INT128) {                            \
+            size_t size = acc == WIDE_INT64 ? sizeof(int64_t) : sizeof(__int128); \
+            void *M = malloc((size_t)n * (size_t)n * size);                       \
+            if (!M) return 0.0;                                                   \
+            res = acc == WIDE_INT64 ? (double)bareiss_##SUF##_i64(A, n, (int64_t*)M) \
+                                    : (double)bareiss_##SUF##_i128(A, n, (__int128*)M); \
+            free(M);                                                              \
+        } else if (acc == WIDE_MODULAR) {                                         \
+            int count = wide_prime_count(h_bits);                                 \
+            uint64_t residues[PERM_MAX_RESIDUES];                                 \
+            int32_t *W = (int32_t*)malloc((size_t)n * (size_t)n * sizeof(int32_t)); \
+            uint64_t *M = (uint64_t*)malloc((size_t)n * (size_t)n * sizeof(uint64_t)); \
+            if (!W || !M) { free(W); free(M); return 0.0; }                       \
+            for (int i = 0; i < n * n; i++) W[i] = A[i];                          \
+            for (int j = 0; j < count; j++) residues[j] = det_mod_p(W, n, residue_primes[j], M); \
+            free(W);                                                              \
+            free(M);                                                              \
+            res = crt_to_double(residues, count);                                 \
+        } else {                                                                  \
+            long double *M = (long double*)malloc((size_t)n * (size_t)n * sizeof(long double)); \
+            if (!M) return 0.0;                                                   \
+            res = gauss_##SUF(A, n, M);                                           \
+            free(M);                                                              \
+        }                                                                         \
+        return res;                                                               \
+    }
+
+DEFINE_WIDE_API(i16, int16_t)
+DEFINE_WIDE_API(i32, int32_t)
+
+// 14. Automatic engine selection
+//
+// permanent_auto() first applies exact structural reductions:
+//   - a zero row, or fewer nonzero columns than rows, gives 0;
+//   - zero columns are dropped;
+//   - a row with one nonzero a_rc is expanded: a_rc * perm(A - row r - col c),
+//     and so is a column with one nonzero when the remaining block is square;
+//   - the rest splits into the connected blocks of its zero pattern, and the
+//     permanent is the product of the block permanents.
+// Every block is then priced per engine as ns_per_call + ns_per_unit * units:
+//   spies          n 2^(n-1)                permanent(), padded Gray-code pass
+//   ryser_new      m 2^n                    only if Π row sums fits int64
+//   ryser          m n Σ_{t<=m} C(n,t)      permanent_ryser(), explicit subsets
+//   multiplicity   n Π (mult_j + 1)         equal rows (or columns, if square)
+//   table          C(n, 4) lookup pairs     (0,1) blocks with n <= 8, always
+// The cheapest engine whose double sums cannot round (bounded from the row
+// sums and, for the padded engines, n - m) wins; without one, the smallest
+// rounding bits + log2(cost).
+// The built-in constants were measured on an AVX-512 node; permanent_calibrate()
+// re-measures them and PERMANENT_TUNING=<file> loads a saved set at load time.
+
+enum auto_engine {
+    AUTO_STRUCTURAL, AUTO_TABLE, AUTO_SPIES, AUTO_RYSER_NEW, AUTO_RYSER, AUTO_MULTIPLICITY,
+    AUTO_ENGINES
+};
+
+static const char *const auto_engine_names[AUTO_ENGINES] = {
+    "structural", "table", "spies", "ryser_new", "ryser", "multiplicity"
+};
+
+// Built-in costs: ns per call and ns per unit (see permanent_calibrate()).
+// Table units are lookup pairs, C(n, 4) (one lookup for n <= 4).
+#define AUTO_TABLE_CALL      35.7
+#define AUTO_TABLE_UNIT      2.52
+#define AUTO_SPIES_CALL      105.0
+#define AUTO_SPIES_UNIT      0.58
+#define AUTO_RYSER_NEW_CALL  310.0
+#define AUTO_RYSER_NEW_UNIT  2.57
+#define AUTO_RYSER_CALL      20.0
+#define AUTO_RYSER_UNIT      1.92
+#define AUTO_MULT_CALL       96.0
+#define AUTO_MULT_UNIT       1.06
+
+// { ns per call, ns per unit }, indexed by enum auto_engine.
+static double auto_cost[AUTO_ENGINES][2] = {
+    { 0.0, 0.0 },
+    { AUTO_TABLE_CALL, AUTO_TABLE_UNIT },
+    { AUTO_SPIES_CALL, AUTO_SPIES_UNIT },
+    { AUTO_RYSER_NEW_CALL, AUTO_RYSER_NEW_UNIT },
+    { AUTO_RYSER_CALL, AUTO_RYSER_UNIT },
+    { AUTO_MULT_CALL, AUTO_MULT_UNIT },
+};
+
+typedef struct {
+    int engine;
+    int by_columns;         // multiplicity over the columns of a square block
+    double cost;            // predicted ns
+} AutoPlan;
+
+// Multiplicity terms Π (mult_j + 1) over the rows of the rows x n matrix M.
+static double auto_group_terms(const int8_t *M, int rows, int n, int *rep, int *mult, uint64_t *hash) {
+    int k = group_lines(M, rows, n, rep, mult, hash);
+    return multiplicity_terms(mult, k);
+}
+
+// Keeps the cheapest engine whose double sums cannot round (sum_bits: log2 of
+// Σ |terms| relative to the result unit, at most 52). Until one is found, a
+// bit of rounding bound is worth a factor 2 of cost: the smallest
+// bits + log2(cost) wins, so an engine may cost at most 2^d times more to win
+// by d bits (and a 1-bit smaller bound never wins at 100x the cost).
+static void auto_consider(AutoPlan *plan, double *plan_bits, int engine, int by_columns,
+                          double units, double sum_bits) {
+    double cost = auto_cost[engine][0] + auto_cost[engine][1] * units;
+    double bits = sum_bits <= 52.0 ? 52.0 : ceil(sum_bits);
+    int take;
+    if (bits == 52.0 || *plan_bits == 52.0)
+        take = bits < *plan_bits || (bits == *plan_bits && cost < plan->cost);
+    else
+        take = bits + log2(cost) < *plan_bits + log2(plan->cost);
+    if (take) {
+        plan->engine = engine;
+        plan->by_columns = by_columns;
+        plan->cost = cost;
+        *plan_bits = bits;
+    }
+}
+
+// Lookup pairs of the table kernel for an n x n (0,1) matrix.
+static double auto_table_units(int n) {
+    return n > 4 ? binom_int(n, 4) : 1.0;
+}
+
+// Picks the engine for the m x n block B (2 <= m <= n, no zero rows).
+// BT is its transpose; work holds 2 * n ints, hash n entries.
+static void auto_plan(const int8_t *B, const int8_t *BT, int m, int n, int *work,
+                      uint64_t *hash, AutoPlan *plan) {
+    int binary = 1;
+    double value_bits = 0.0;                // log2 Π row sums of |a_ij|
+    for (int r = 0; r < m; r++) {
+        int64_t row_abs = 0;
+        for (int c = 0; c < n; c++) {
+            int8_t a = B[(size_t)r * n + c];
+            if (a != 0 && a != 1) binary = 0;
+            row_abs += a < 0 ? -a : a;
+        }
+        value_bits += log2((double)row_abs);
+    }
+
+    plan->engine = AUTO_SPIES;
+    plan->by_columns = 0;
+    plan->cost = HUGE_VAL;
+    if (binary && n <= TABLE_MAX_N && tables_enabled) {
+        plan->engine = AUTO_TABLE;
+        plan->cost = auto_cost[AUTO_TABLE][0] + auto_cost[AUTO_TABLE][1] * auto_table_units(n);
+        return;
+    }
+
+    // Padding rows (sums n) count in the padded engines; (n - m)! is divided out.
+    double pad_bits = value_bits + (n - m) * log2((double)n) - lgamma(n - m + 1.0) / log(2.0);
+    double weights = 0.0, subsets = 0.0;    // Σ_t C(n,t) C(n-t,m-t), Σ_t C(n,t)
+    for (int t = 1; t <= m; t++) {
+        weights += binom_int(n, t) * binom_int(n - t, m - t);
+        subsets += binom_int(n, t);
+    }
+    double bits = HUGE_VAL;
+    if (n <= 63)
+        auto_consider(plan, &bits, AUTO_SPIES, 0, (double)n * ldexp(1.0, n - 1), pad_bits);
+    if (n <= 62 && value_bits < 62.0)
+        auto_consider(plan, &bits, AUTO_RYSER_NEW, 0, (double)m * ldexp(1.0, n),
+                      value_bits + log2(weights));
+    auto_consider(plan, &bits, AUTO_RYSER, 0, (double)m * n * subsets, value_bits + log2(weights));
+
+    // Multinomial weights add at most 2^n to Σ |terms|.
+    int *rep = work, *mult = work + n;
+    double terms = auto_group_terms(B, m, n, rep, mult, hash) * (double)(n - m + 1);
+    auto_consider(plan, &bits, AUTO_MULTIPLICITY, 0, (double)n * terms, pad_bits + n);
+    if (m == n) {
+        double col_bits = 0.0;              // log2 Π column sums of |a_ij|
+        for (int c = 0; c < n; c++) {
+            int64_t col_abs = 0;
+            for (int r = 0; r < n; r++) col_abs += abs(BT[(size_t)c * n + r]);
+            col_bits += log2((double)col_abs);
+        }
+        double terms_c = auto_group_terms(BT, n, n, rep, mult, hash);
+        auto_consider(plan, &bits, AUTO_MULTIPLICITY, 1, (double)n * terms_c, col_bits + n);
+    }
+}
+
+// Spies on the padded block, without permanent()'s own multiplicity switch.
+static double auto_spies(const int8_t *B, int m, int n) {
+    int8_t *T = (int8_t*)malloc((size_t)n * (size_t)n);
+    if (!T) return 0.0;
+    memset(T, 1, (size_t)n * (size_t)n);
+    for (int r = 0; r < m; r++)
+        for (int c = 0; c < n; c++) T[(size_t)c * n + r] = B[(size_t)r * n + c];
+    double res = fast_permanent_kernel(T, n);
+    free(T);
+    return m < n ? res / factorial(n - m) : res;
+}
+
+static double auto_execute(const int8_t *B, const int8_t *BT, int m, int n, int *work,
+                           uint64_t *hash, const AutoPlan *plan) {
+    switch (plan->engine) {
+    case AUTO_RYSER_NEW: return ryser_new(B, m, n);
+    case AUTO_RYSER:     return permanent_ryser(B, m, n);
+    case AUTO_MULTIPLICITY: {
+        const int8_t *src = plan->by_columns ? BT : B;
+        int *rep = work, *mult = work + n;
+        int k = group_lines(src, m, n, rep, mult, hash);
+        int8_t *lines = (int8_t*)malloc((size_t)k * (size_t)n);
+        if (!lines) return 0.0;
+        for (int j = 0; j < k; j++)
+            memcpy(&lines[(size_t)j * n], &src[(size_t)rep[j] * n], (size_t)n);
+        double res = permanent_multiplicity(lines, mult, k, n);
+        free(lines);
+        return res;
+    }
+    case AUTO_SPIES:     return auto_spies(B, m, n);
+    default:             return permanent(B, m, n);      // tables
+    }
+}
+
+static int uf_find(int *parent, int x) {
+    while (parent[x] != x) x = parent[x] = parent[parent[x]];
+    return x;
+}
+
+// Reduces A (m x n, 1 <= m <= n) and evaluates or only plans its blocks.
+// With execute = 0 the return value is unspecified and *engine is the
+// engine of the costliest block (AUTO_STRUCTURAL if none is left).
+static double auto_run(const int8_t *A, int m, int n, int execute, int *engine) {
+    int *row_on = (int*)malloc((size_t)(4 * m + 7 * n) * sizeof(int));
+    int8_t *B = (int8_t*)malloc((size_t)m * (size_t)n * 2);
+    uint64_t *hash = (uint64_t*)malloc((size_t)n * sizeof(uint64_t));
+    if (!row_on || !B || !hash) { free(row_on); free(B); free(hash); return 0.0; }
+    int *col_on = row_on + m, *parent = col_on + n;       // parent: m + n entries
+    int *seen = parent + m + n, *brows = seen + m + n, *bcols = brows + m, *work = bcols + n;
+    int8_t *BT = B + (size_t)m * n;
+
+    for (int r = 0; r < m; r++) row_on[r] = 1;
+    for (int c = 0; c < n; c++) col_on[c] = 1;
+    int rows = m, cols = n;
+    double factor = 1.0;
+    if (engine) *engine = AUTO_STRUCTURAL;
+
+    for (int changed = 1; changed && factor != 0.0; ) {
+        changed = 0;
+        for (int r = 0; r < m && factor != 0.0; r++) {
+            if (!row_on[r]) continue;
+            int count = 0, last = -1;
+            for (int c = 0; c < n; c++)
+                if (col_on[c] && A[(size_t)r * n + c]) { count++; last = c; }
+            if (count == 0) factor = 0.0;
+            else if (count == 1) {
+                factor *= A[(size_t)r * n + last];
+                row_on[r] = 0; col_on[last] = 0; rows--; cols--;
+                changed = 1;
+            }
+        }
+        for (int c = 0; c < n && factor != 0.0; c++) {
+            if (!col_on[c]) continue;
+            int count = 0, last = -1;
+            for (int r = 0; r < m; r++)
+                if (row_on[r] && A[(size_t)r * n + c]) { count++; last = r; }
+            if (count == 0) {
+                col_on[c] = 0; cols--;
+                changed = 1;
+            } else if (count == 1 && rows == cols) {
+                factor *= A[(size_t)last * n + c];
+                row_on[last] = 0; col_on[c] = 0; rows--; cols--;
+                changed = 1;
+            }
+        }
+        if (rows > cols) factor = 0.0;
+    }
+
+    // Connected blocks: union-find over rows 0..m-1 and columns m..m+n-1.
+    for (int i = 0; i < m + n; i++) { parent[i] = i; seen[i] = 0; }
+    if (factor != 0.0) {
+        for (int r = 0; r < m; r++) {
+            if (!row_on[r]) continue;
+            for (int c = 0; c < n; c++)
+                if (col_on[c] && A[(size_t)r * n + c])
+                    parent[uf_find(parent, r)] = uf_find(parent, m + c);
+        }
+    }
+
+    double worst = -1.0;
+    for (int first = 0; first < m && factor != 0.0; first++) {
+        if (!row_on[first]) continue;
+        int root = uf_find(parent, first);
+        if (seen[root]) continue;
+        seen[root] = 1;
+        int bm = 0, bn = 0;
+        for (int r = 0; r < m; r++) if (row_on[r] && uf_find(parent, r) == root) brows[bm++] = r;
+        for (int c = 0; c < n; c++) if (col_on[c] && uf_find(parent, m + c) == root) bcols[bn++] = c;
+        if (bm > bn) { factor = 0.0; break; }
+        if (bm == 1) {                          // one row: the sum of its entries
+            double sum = 0.0;
+            for (int j = 0; j < bn; j++) sum += A[(size_t)brows[0] * n + bcols[j]];
+            factor *= sum;
+            continue;
+        }
+        for (int i = 0; i < bm; i++)
+            for (int j = 0; j < bn; j++) {
+                int8_t a = A[(size_t)brows[i] * n + bcols[j]];
+                B[(size_t)i * bn + j] = a;
+                BT[(size_t)j * bm + i] = a;
+            }
+        AutoPlan plan;
+        auto_plan(B, BT, bm, bn, work, hash, &plan);
+        if (plan.cost > worst) {
+            worst = plan.cost;
+            if (engine) *engine = plan.engine;
+        }
+        if (execute) factor *= auto_execute(B, BT, bm, bn, work, hash, &plan);
+    }
+    free(row_on); free(B); free(hash);
+    return factor;
+}
+
+double permanent_auto(const int8_t *A, int m, int n) {
+    if (m < 0 || n < 0) return 0.0;
+    if (m == 0) return 1.0;
+    if (!A || m > n) return 0.0;
+    return auto_run(A, m, n, 1, NULL);
+}
+
+const char *permanent_auto_engine(const int8_t *A, int m, int n) {
+    int engine = AUTO_STRUCTURAL;
+    if (A && m >= 1 && m <= n) auto_run(A, m, n, 0, &engine);
+    return auto_engine_names[engine];
+}
+
+int permanent_load_tuning(const char *path) {
+    FILE *fp = path ? fopen(path, "r") : NULL;
+    if (!fp) return -1;
+    double cost[AUTO_ENGINES][2];
+    memcpy(cost, auto_cost, sizeof(cost));
+    char line[256], name[64];
+    int rc = 0;
+    while (rc == 0 && fgets(line, sizeof(line), fp)) {
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        double call, unit;
+        int fields = sscanf(line, "%63s %lf %lf", name, &call, &unit);
+        if (fields <= 0) continue;                      // blank or comment
+        int e = AUTO_TABLE;
+        while (e < AUTO_ENGINES && strcmp(name, auto_engine_names[e]) != 0) e++;
+        if (fields != 3 || e == AUTO_ENGINES || !(call >= 0.0) || !(unit > 0.0)) rc = -1;
+        else { cost[e][0] = call; cost[e][1] = unit; }
+    }
+    fclose(fp);
+    if (rc == 0) memcpy(auto_cost, cost, sizeof(cost));
+    return rc;
+}
+
+static double auto_now(void) {
+#ifdef _OPENMP
+    return omp_get_wtime();
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static volatile double auto_sink;
+
+// ns per call of one engine on B, repeated for at least min_time seconds.
+static double auto_time(int engine, const int8_t *B, int m, int n, double min_time) {
+    int8_t *lines = NULL;
+    int mult[64], k = 0;
+    if (engine == AUTO_MULTIPLICITY) {                  // B holds k distinct rows, 3 copies each
+        k = m / 3;
+        lines = (int8_t*)malloc((size_t)k * (size_t)n);
+        if (!lines) return 0.0;
+        for (int j = 0; j < k; j++) {
+            memcpy(&lines[(size_t)j * n], &B[(size_t)j * n], (size_t)n);
+            mult[j] = 3;
+        }
+    }
+    long long calls = 0;
+    double start = auto_now(), elapsed;
+    do {
+        double v;
+        switch (engine) {
+        case AUTO_RYSER_NEW:    v = ryser_new(B, m, n); break;
+        case AUTO_RYSER:        v = permanent_ryser(B, m, n); break;
+        case AUTO_MULTIPLICITY: v = permanent_multiplicity(lines, mult, k, n); break;
+        default:                v = permanent(B, m, n); break;
+        }
+        auto_sink = v;
+        calls++;
+        elapsed = auto_now() - start;
+    } while (elapsed < min_time);
+    free(lines);
+    return elapsed * 1e9 / (double)calls;
+}
+
+int permanent_calibrate(const char *path, double seconds) {
+    // Per engine a small shape (fixed cost) and a large one (unit cost).
+    static const struct { int engine, m0, n0, m1, n1; } cases[] = {
+        { AUTO_TABLE,        5,  5,  8,  8 },
+        { AUTO_SPIES,        5,  5, 18, 18 },
+        { AUTO_RYSER_NEW,    5,  5, 10, 18 },
+        { AUTO_RYSER,        3,  6,  5, 22 },
+        { AUTO_MULTIPLICITY, 6,  6, 24, 24 },
+    };
+    const int ncases = (int)(sizeof(cases) / sizeof(cases[0]));
+    double min_time = (seconds > 0.0 ? seconds : 2.0) / (2.0 * ncases);
+
+    int8_t *B = (int8_t*)malloc(24 * 24);
+    if (!B) return -1;
+    uint64_t rng = 0x2545F4914F6CDD1DULL;
+    double cost[AUTO_ENGINES][2];
+    memcpy(cost, auto_cost, sizeof(cost));
+
+    for (int i = 0; i < ncases; i++) {
+        double t[2], units[2];
+        for (int size = 0; size < 2; size++) {
+            int m = size ? cases[i].m1 : cases[i].m0, n = size ? cases[i].n1 : cases[i].n0;
+            // Entries in {-1, 0, 1}: no table path, distinct rows ((0,1) for the tables).
+            int k = cases[i].engine == AUTO_TABLE ? 2 : 3, lo = k == 2 ? 0 : -1;
+            for (int j = 0; j < m * n; j++) B[j] = (int8_t)((int)(splitmix64(&rng) % k) + lo);
+            if (cases[i].engine == AUTO_MULTIPLICITY)
+                for (int r = m / 3; r < m; r++) memcpy(&B[r * n], &B[(r % (m / 3)) * n], (size_t)n);
+            switch (cases[i].engine) {
+            case AUTO_TABLE:     units[size] = auto_table_units(n); break;
+            case AUTO_SPIES:     units[size] = (double)n * ldexp(1.0, n - 1); break;
+            case AUTO_RYSER_NEW: units[size] = (double)m * ldexp(1.0, n); break;
+            case AUTO_RYSER: {
+                double subsets = 0.0;
+                for (int s = 1; s <= m; s++) subsets += binom_int(n, s);
+                units[size] = (double)m * n * subsets;
+                break;
+            }
+            default:             units[size] = (double)n * pow(4.0, m / 3); break;
+            }
+            t[size] = auto_time(cases[i].engine, B, m, n, min_time);
+        }
+        double unit = (t[1] - t[0]) / (units[1] - units[0]);
+        if (!(unit > 0.0)) unit = t[1] / units[1];
+        double call = t[0] - unit * units[0];
+        cost[cases[i].engine][0] = call > 0.0 ? call : 0.0;
+        cost[cases[i].engine][1] = unit;
+    }
+    free(B);
+    memcpy(auto_cost, cost, sizeof(cost));
+
+    if (!path) return 0;
+    FILE *fp = fopen(path, "w");
+    if (!fp) return -1;
+    fprintf(fp, "# permanent_auto tuning (kernels: %s)\n", permanent_isa());
+    fprintf(fp, "# engine  ns_per_call  ns_per_unit\n");
+    for (int e = AUTO_TABLE; e < AUTO_ENGINES; e++)
+        fprintf(fp, "%s %.3f %.6g\n", auto_engine_names[e], cost[e][0], cost[e][1]);
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+// Runs at load time: PERMANENT_TUNING=<file> replaces the built-in costs.
+__attribute__((constructor))
+static void load_tuning_env(void) {
+    const char *path = getenv("PERMANENT_TUNING");
+    if (path && *path && permanent_load_tuning(path) != 0)
+        fprintf(stderr, "permanent: cannot read PERMANENT_TUNING=%s, using built-in costs\n", path);
+}
+
+// --- RUNTIME CPU DISPATCH ---
+//
+// One copy of every kernel per instruction set. The bodies above are
+// always-inline, so each wrapper is compiled with its own target options.
+// PERMANENT_ISA=generic|avx2|avx512 forces a variant (e.g. for benchmarks).
+
+#define DEFINE_KERNELS(SUFFIX, ATTR)                                              \
+    ATTR static double spies_##SUFFIX(const int8_t *T, int n) {                  \
+        return fast_permanent_kernel_body(T, n);                                  \
+    }                                                                             \
+    ATTR static double ryser_##SUFFIX(const int8_t *A, int m, int n) {           \
+        return ryser_new_body(A, m, n);                                           \
+    }                                                                             \
+    ATTR static double determinant_##SUFFIX(const int8_t *A, int n) {            \
+        return determinant_body(A, n);                                            \
+    }                                                                             \
+    ATTR static void row_values_##SUFFIX(const double *pm, const double *cf,     \
+                                         int n, int lo, int hi,                   \
+                                         double *perms, double *dets) {           \
+        laplace_row_values_body(pm, cf, n, lo, hi, perms, dets);                  \
+    }                                                                             \
+    ATTR static void packed_values_##SUFFIX(const double *pm, const double *cf,  \
+                                            int n, const uint64_t *leaves,        \
+                                            int count, double *perms,             \
+                                            double *dets) {                       \
+        packed_values_body(pm, cf, n, leaves, count, perms, dets);                \
+    }                                                                             \
+    ATTR static void minors_##SUFFIX(const double *A, int n, uint64_t lo,        \
+                                     uint64_t hi, double *G, double *work) {      \
+        minors_chunk_body(A, n, lo, hi, G, work);                                 \
+    }                                                                             \
+    static const struct perm_kernels kernels_##SUFFIX = {                         \
+        #SUFFIX, spies_##SUFFIX, ryser_##SUFFIX,                                  \
+        determinant_##SUFFIX, row_values_##SUFFIX, packed_values_##SUFFIX,        \
+        minors_##SUFFIX                                                           \
+    };
+
+DEFINE_KERNELS(generic, )
+
+#if defined(__x86_64__) || defined(__i386__)
+#  define PERM_X86_DISPATCH 1
+DEFINE_KERNELS(avx2, __attribute__((target("avx2,fma,bmi,bmi2,popcnt"))))
+DEFINE_KERNELS(avx512, __attribute__((target("avx512f,avx512vl,avx512bw,avx512dq,avx2,fma,bmi,bmi2,popcnt"))))
+#endif
+
+static const struct perm_kernels *active_kernels = &kernels_generic;
+
+static int isa_supported(const struct perm_kernels *k) {
+#ifdef PERM_X86_DISPATCH
+    __builtin_cpu_init();
+    if (k == &kernels_avx2)
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+               __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("popcnt");
+    if (k == &kernels_avx512)
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl") &&
+               __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq") &&
+               __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+               __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("popcnt");
+#endif
+    return k == &kernels_generic;
+}
+
+static const struct perm_kernels *isa_by_name(const char *name) {
+    if (strcmp(name, "generic") == 0) return &kernels_generic;
+#ifdef PERM_X86_DISPATCH
+    if (strcmp(name, "avx2") == 0) return &kernels_avx2;
+    if (strcmp(name, "avx512") == 0) return &kernels_avx512;
+#endif
+    return NULL;
+}
+
+int permanent_set_isa(const char *name) {
+    const struct perm_kernels *k = name ? isa_by_name(name) : NULL;
+    if (!k || !isa_supported(k)) return -1;
+    active_kernels = k;
+    return 0;
+}
+
+const char *permanent_isa(void) {
+    return active_kernels->name;
+}
+
+// Runs at load time: best variant the CPU supports, unless PERMANENT_ISA says otherwise.
+__attribute__((constructor))
+static void select_kernels(void) {
+#ifdef PERM_X86_DISPATCH
+    if (isa_supported(&kernels_avx512)) active_kernels = &kernels_avx512;
+    else if (isa_supported(&kernels_avx2)) active_kernels = &kernels_avx2;
+#endif
+    const char *forced = getenv("PERMANENT_ISA");
+    if (forced && *forced && permanent_set_isa(forced) != 0) {
+        fprintf(stderr, "permanent: PERMANENT_ISA=%s not available on this CPU, using %s\n",
+                forced, active_kernels->name);
+    }
+}
@@ -2,6 +2,7 @@
 #define PERMANENT_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 /*
  * Calculates the permanent of an m x n matrix (A).
@@ -31,6 +32,28 @@ double permanent_ryser(const int8_t *A, int m, int n);
 double ryser_new(const int8_t *A, int m, int n);
 
 
+/*
+ * Permanent of a matrix with repeated rows, given as k distinct rows R
+ * (k x n, row-major) where row j occurs mult[j] times (sum mult[j] = m <= n).
+ * Uses Ryser's formula with equal rows grouped: Π (mult[j] + 1) terms with
+ * multinomial weights instead of 2^n. Repeated columns are handled by passing
+ * the transpose. permanent() switches to this method by itself when it finds
+ * enough repeated rows or columns and the grouped sum provably cannot round
+ * (2^n times the product of the line sums stays below 2^52).
+ */
+double permanent_multiplicity(const int8_t *R, const int *mult, int k, int n);
+
+/*
+ * Laplace expansion along the last row of an n x n matrix.
+ * A holds only the first n-1 rows ((n-1) x n, row-major). For every column j:
+ * - perm_minors[j]: permanent of A with column j deleted.
+ * - cofactors[j]:   (-1)^(n-1+j) * determinant of A with column j deleted.
+ * Any last row x then gives perm = Σ x_j perm_minors[j] and det = Σ x_j cofactors[j].
+ * Either output may be NULL. Both are zeroed if the (n > 9 only) minor
+ * buffer cannot be allocated.
+ */
+void laplace_last_row(const int8_t *A, int n, double *perm_minors, double *cofactors);
+
 /* * Calculates the exact determinant using the Bareiss Algorithm.
  * * Features:
  * - Performs exact integer arithmetic (fraction-free Gaussian elimination).
@@ -39,4 +62,174 @@ double ryser_new(const int8_t *A, int m, int n);
  */
 double determinant(const int8_t *A, int n);
 
+/*
+ * Candidate last rows for laplace_last_row(): for every val in [lo, hi) the
+ * bits of val form the last row x (bit j = column j), and
+ *   perms[val - lo] = Σ x_j perm_minors[j],  dets[val - lo] = Σ x_j cofactors[j].
+ * Used by the searchers to evaluate all children of a parent in one call.
+ */
+void laplace_row_values(const double *perm_minors, const double *cofactors, int n,
+                        int lo, int hi, double *perms, double *dets);
+
+/*
+ * Distributed single-permanent computation.
+ * The Spies kernel for an n x n matrix sums 2^(n-1) Gray-code terms
+ *   perm(A) = 2^-(n-1) Σ_{i=0}^{2^(n-1)-1} (-1)^i Π_r s_r(gray(i)),
+ * and any index range [lo, hi) can be computed on its own, starting from gray(lo).
+ * - permanent_gray_range(): partial sum over [lo, hi), NOT divided by 2^(n-1),
+ *   as residues modulo the first 'count' primes (exact, OpenMP-parallel).
+ *   Returns 0 on success, -1 on invalid input.
+ * - permanent_residue_count(): number of primes needed to recover perm(A)
+ *   exactly (CRT) from the summed residues.
+ * - permanent_residue_prime(): the i-th prime (all lie between 2^61 and 2^62).
+ * - permanent_residue_decimal(): the exact signed perm(A) in decimal from the
+ *   summed gray-range residues over [0, 2^(n-1)) (divides by 2^(n-1), CRT).
+ *   Returns 0, or -1 on invalid input or if 'size' is too small
+ *   (PERM_DECIMAL_MAX bytes always suffice).
+ * See permanent_dist.c for the job runner and combiner.
+ */
+#define PERM_MAX_RESIDUES 16
+int permanent_gray_range(const int8_t *A, int n, uint64_t lo, uint64_t hi,
+                         int count, uint64_t *residues);
+int permanent_residue_count(const int8_t *A, int n);
+uint64_t permanent_residue_prime(int i);
+#define PERM_DECIMAL_MAX 320
+int permanent_residue_decimal(const uint64_t *residues, int count, int n, char *buf, size_t size);
+
+/*
+ * Batched permanent and determinant of bit-packed n x n (0,1)-matrices, n <= 8.
+ * Leaf k stores row r in byte r (bit j = column j). Consecutive leaves with the
+ * same first n-1 rows share one laplace_last_row() call, so batches produced by
+ * a depth-first enumeration cost little more than two dot products per leaf.
+ * Results are exact integers (returned as doubles like the other functions).
+ */
+void permanent_det_packed(const uint64_t *leaves, int count, int n, double *perms, double *dets);
+
+/*
+ * permanent_det_packed() settles det == 0 for each run of leaves with the
+ * cheapest exact test first: a zero or repeated row among the shared first
+ * n-1 rows makes the whole run singular (no cofactors are computed), all-zero
+ * cofactors (shared rows of lower rank) do the same, and only the remaining
+ * leaves need the last-row dot product. permanent_det_packed_stats() also adds
+ * the number of leaves settled at each stage to *stats (zeroed by the caller).
+ */
+typedef struct {
+    long long leaves;
+    long long parents;              // runs of leaves sharing rows 0..n-2
+    long long parent_structural;    // zero or repeated shared row: singular
+    long long parent_rank;          // shared rows of lower rank: singular
+    long long leaf_exact;           // settled by the last-row cofactor sum
+} SingularityStats;
+
+void permanent_det_packed_stats(const uint64_t *leaves, int count, int n, double *perms,
+                                double *dets, SingularityStats *stats);
+
+/*
+ * All (n-1) x (n-1) minor permanents in one Gray-code pass.
+ * minors[i*n + j] = permanent of A with row i and column j deleted
+ *                 = ∂perm(A)/∂a_ij,
+ * for an n x n matrix A (row-major). Costs O(n 2^n) like a single
+ * permanent instead of n^2 separate calls; OpenMP-parallel over Gray-code
+ * ranges. Returns perm(A). Double results (not exact for huge values).
+ */
+double permanent_minors(const int8_t *A, int n, double *minors);
+double permanent_minors_d(const double *A, int n, double *minors);
+
+/*
+ * Approximate permanent of a nonnegative n x n matrix (row-major doubles),
+ * for sizes beyond the exact kernels.
+ * - Sinkhorn scaling to a doubly stochastic B gives deterministic bounds:
+ *   van der Waerden (lower), min of Π row sums, Π column sums and Brègman
+ *   for (0,1) inputs (upper).
+ * - Sequential importance sampling on B (unbiased), OpenMP-parallel, runs
+ *   until the CLT half-width at the given confidence is at most rel_err
+ *   relative to the estimate, or max_samples (<= 0: default 10^8) is reached.
+ * Results are also given as logarithms (perm(A) may exceed the double range).
+ * The interval is statistical; 'converged' is 0 if Sinkhorn did not reach
+ * 1e-9 (no lower bound then, and only the unscaled upper bounds) or the error
+ * target was not met. Without a perfect matching the result is an exact 0.
+ * Returns 0 on success, -1 on invalid input (negative/NaN entries, bad rel_err
+ * or confidence) or out of memory. Same seed and thread count: same result.
+ */
+typedef struct {
+    double estimate;            // perm(A)
+    double half_width;          // confidence half-width (absolute)
+    double rel_half_width;      // half_width / estimate
+    double lower_bound;         // deterministic bounds
+    double upper_bound;
+    double log_estimate;        // natural logarithms of the above
+    double log_lower;
+    double log_upper;
+    long long samples;
+    int sinkhorn_iterations;
+    int converged;
+} PermanentApprox;
+
+int permanent_approx(const double *A, int n, double rel_err, double confidence,
+                     long long max_samples, uint64_t seed, PermanentApprox *out);
+
+/*
+ * Wider entry types: int16_t and int32_t variants of permanent, ryser_new
+ * and determinant (same arguments and conventions as the int8_t versions).
+ * The accumulator is chosen from a cheap bound (row sums for permanents,
+ * the Hadamard bound for determinants): int64, __int128, or residues modulo
+ * primes near 2^62 with CRT. Results are exact integers rounded once to
+ * double, up to about 900 bits; larger bounds fall back to floating point.
+ */
+double permanent_i16(const int16_t *A, int m, int n);
+double permanent_i32(const int32_t *A, int m, int n);
+double ryser_new_i16(const int16_t *A, int m, int n);
+double ryser_new_i32(const int32_t *A, int m, int n);
+double determinant_i16(const int16_t *A, int n);
+double determinant_i32(const int32_t *A, int n);
+
+/*
+ * Automatic engine selection for the permanent of an m x n matrix.
+ * - Exact structural reductions first: zero rows/columns, rows (and, for
+ *   square blocks, columns) with a single nonzero entry, and the split into
+ *   the connected blocks of the zero pattern (product of block permanents).
+ * - Each block goes to the cheapest of permanent() (tables / Spies),
+ *   ryser_new, permanent_ryser and permanent_multiplicity, by a cost model
+ *   over its shape, repeated rows/columns and entry range: the cheapest
+ *   engine whose double sums provably cannot round; if none can, each bit
+ *   of rounding bound is traded against a factor 2 of cost. ryser_new is
+ *   used only when its int64 products cannot overflow.
+ * - permanent_auto_engine(): name of the engine used for the costliest
+ *   block ("structural" if the reductions alone settle the permanent).
+ * - permanent_calibrate(): times every engine on this machine (about
+ *   'seconds' in total), uses the new costs and saves them to 'path'
+ *   (if not NULL). The environment variable PERMANENT_TUNING names a saved
+ *   file to load when the library is loaded; permanent_load_tuning() loads
+ *   one explicitly. Both return 0 on success, -1 on I/O or format errors.
+ */
+double permanent_auto(const int8_t *A, int m, int n);
+const char *permanent_auto_engine(const int8_t *A, int m, int n);
+int permanent_calibrate(const char *path, double seconds);
+int permanent_load_tuning(const char *path);
+
+/*
+ * Table-driven kernel for small (0,1) matrices.
+ * Permanents and determinants of all k x k (0,1)-matrices with k <= 4 are
+ * tabulated when the library is loaded (2^16 entries for k = 4). Square
+ * (0,1) inputs up to 8 x 8 in permanent(), determinant(), laplace_last_row()
+ * and permanent_det_packed() are then a Laplace expansion over column
+ * subsets of the top rows with table lookups for both blocks (70 lookup
+ * pairs for 8 x 8). Other inputs are not affected.
+ * - permanent_set_tables(0) switches back to the general kernels (for
+ *   benchmarks); returns the previous setting.
+ */
+int permanent_set_tables(int enabled);
+
+/*
+ * Runtime CPU dispatch.
+ * The hot kernels (Spies, ryser_new, determinant, last-row values, packed
+ * batches, minor permanents) exist in generic, AVX2 and AVX-512 variants;
+ * the best one the CPU supports is picked when the library is loaded. The
+ * environment variable PERMANENT_ISA (generic, avx2, avx512) forces a variant.
+ * - permanent_isa(): name of the active variant.
+ * - permanent_set_isa(): switch variant; returns -1 if unknown or unsupported.
+ */
+const char *permanent_isa(void);
+int permanent_set_isa(const char *name);
+
 #endif
@@ -0,0 +1,277 @@
+/*
+ * permanent_dist.c
+ * Distributed computation of ONE large permanent (n = 40..48 and up).
+ *
+ * Strategy:
+ * - The Spies kernel sums 2^(n-1) Gray-code terms; any index range [lo, hi)
+ *   is an independent job that starts directly from gray(lo).
+ * - Each job writes an exact partial sum (residues modulo up to 16 primes
+ *   near 2^62) to its own file. Files are written to "<out>.tmp" and renamed,
+ *   so a failed job never leaves a half-written part behind and can simply be
+ *   rerun by the batch scheduler.
+ * - The combiner checks that every index is covered exactly once by parts of
+ *   the same matrix, adds the residues and prints the exact (signed) integer
+ *   through permanent_residue_decimal() (division by 2^(n-1), Chinese
+ *   Remainder Theorem; the same reconstruction as the wide-entry kernels).
+ *
+ * Usage:
+ *   permanent_dist split   <matrix> <jobs>            print the job ranges
+ *   permanent_dist run     <matrix> <lo> <hi> <out>   compute one range
+ *   permanent_dist combine <part> [<part> ...]        check coverage, print perm
+ *
+ * Matrix file: n followed by n*n integers in [-128, 127] (row-major, any whitespace).
+ * Dependencies: permanent.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <omp.h>
+#include "permanent.h"
+
+#define PART_MAGIC "permanent-part-v1"
+
+typedef struct {
+    char path[512];
+    int n;
+    uint64_t fingerprint;
+    uint64_t lo, hi;
+    int count;
+    uint64_t residues[PERM_MAX_RESIDUES];
+} Part;
+
+// --- 1. INPUT ---
+
+static int8_t *read_matrix(const char *path, int *n_out) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) { perror(path); return NULL; }
+
+    int n;
+    if (fscanf(fp, "%d", &n) != 1 || n < 1 || n > 63) {
+        fprintf(stderr, "%s: expected order n in 1..63\n", path);
+        fclose(fp);
+        return NULL;
+    }
+    int8_t *A = (int8_t*)malloc((size_t)n * n);
+    if (!A) { fclose(fp); return NULL; }
+    for (int i = 0; i < n * n; i++) {
+        int v;
+        if (fscanf(fp, "%d", &v) != 1 || v < -128 || v > 127) {
+            fprintf(stderr, "%s: entry %d missing or outside [-128, 127]\n", path, i);
+            free(A);
+            fclose(fp);
+            return NULL;
+        }
+        A[i] = (int8_t)v;
+    }
+    fclose(fp);
+    *n_out = n;
+    return A;
+}
+
+// FNV-1a over n and the entries: parts of different matrices never mix.
+static uint64_t matrix_fingerprint(const int8_t *A, int n) {
+    uint64_t h = 1469598103934665603ULL;
+    h ^= (uint64_t)n;
+    h *= 1099511628211ULL;
+    for (int i = 0; i < n * n; i++) {
+        h ^= (uint8_t)A[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static int parse_u64(const char *s, uint64_t *out) {
+    char *end;
+    unsigned long long v = strtoull(s, &end, 0);
+    if (*s == '\0' || *end != '\0') return -1;
+    *out = (uint64_t)v;
+    return 0;
+}
+
+// --- 2. PART FILES ---
+
+static int write_part(const char *path, const Part *p) {
+    char tmp[600];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) { perror(tmp); return -1; }
+
+    fprintf(fp, "%s\n", PART_MAGIC);
+    fprintf(fp, "n %d\n", p->n);
+    fprintf(fp, "fingerprint %016" PRIx64 "\n", p->fingerprint);
+    fprintf(fp, "range %" PRIu64 " %" PRIu64 "\n", p->lo, p->hi);
+    fprintf(fp, "residues %d\n", p->count);
+    for (int j = 0; j < p->count; j++)
+        fprintf(fp, "%" PRIu64 " %" PRIu64 "\n", permanent_residue_prime(j), p->residues[j]);
+
+    if (fclose(fp) != 0 || rename(tmp, path) != 0) {
+        perror(path);
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+static int read_part(const char *path, Part *p) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) { perror(path); return -1; }
+
+    char magic[64];
+    int ok = fscanf(fp, "%63s", magic) == 1 && strcmp(magic, PART_MAGIC) == 0 &&
+             fscanf(fp, " n %d", &p->n) == 1 &&
+             fscanf(fp, " fingerprint %" SCNx64, &p->fingerprint) == 1 &&
+             fscanf(fp, " range %" SCNu64 " %" SCNu64, &p->lo, &p->hi) == 2 &&
+             fscanf(fp, " residues %d", &p->count) == 1 &&
+             p->count >= 1 && p->count <= PERM_MAX_RESIDUES;
+    for (int j = 0; ok && j < p->count; j++) {
+        uint64_t prime;
+        ok = fscanf(fp, "%" SCNu64 " %" SCNu64, &prime, &p->residues[j]) == 2 &&
+             prime == permanent_residue_prime(j) && p->residues[j] < prime;
+    }
+    fclose(fp);
+
+    if (!ok) {
+        fprintf(stderr, "%s: not a valid part file\n", path);
+        return -1;
+    }
+    snprintf(p->path, sizeof(p->path), "%s", path);
+    return 0;
+}
+
+// --- 3. COMMANDS ---
+
+static int cmd_split(const char *matrix_path, const char *jobs_arg) {
+    int n;
+    int8_t *A = read_matrix(matrix_path, &n);
+    if (!A) return 1;
+    free(A);
+
+    uint64_t jobs, total = 1ULL << (n - 1);
+    if (parse_u64(jobs_arg, &jobs) != 0 || jobs < 1 || jobs > total) {
+        fprintf(stderr, "jobs must be in 1..%" PRIu64 "\n", total);
+        return 1;
+    }
+    for (uint64_t j = 0; j < jobs; j++) {
+        uint64_t lo = total / jobs * j + (j < total % jobs ? j : total % jobs);
+        uint64_t hi = lo + total / jobs + (j < total % jobs ? 1 : 0);
+        printf("%" PRIu64 " %" PRIu64 "\n", lo, hi);
+    }
+    return 0;
+}
+
+static int cmd_run(const char *matrix_path, const char *lo_arg, const char *hi_arg, const char *out) {
+    int n;
+    int8_t *A = read_matrix(matrix_path, &n);
+    if (!A) return 1;
+
+    Part p;
+    memset(&p, 0, sizeof(p));
+    p.n = n;
+    p.fingerprint = matrix_fingerprint(A, n);
+    p.count = permanent_residue_count(A, n);
+    if (parse_u64(lo_arg, &p.lo) != 0 || parse_u64(hi_arg, &p.hi) != 0 || p.count > PERM_MAX_RESIDUES) {
+        fprintf(stderr, "invalid range or matrix too large for %d residues\n", PERM_MAX_RESIDUES);
+        free(A);
+        return 1;
+    }
+
+    double start_time = omp_get_wtime();
+    int rc = permanent_gray_range(A, n, p.lo, p.hi, p.count, p.residues);
+    double end_time = omp_get_wtime();
+    free(A);
+    if (rc != 0) {
+        fprintf(stderr, "range [%" PRIu64 ", %" PRIu64 ") invalid for n=%d (total %" PRIu64 ")\n",
+                p.lo, p.hi, n, (uint64_t)1 << (n - 1));
+        return 1;
+    }
+    if (write_part(out, &p) != 0) return 1;
+
+    fprintf(stderr, "n=%d range [%" PRIu64 ", %" PRIu64 ") %d residues, %d threads: %.3f seconds\n",
+            n, p.lo, p.hi, p.count, omp_get_max_threads(), end_time - start_time);
+    return 0;
+}
+
+static int cmp_part_lo(const void *a, const void *b) {
+    const Part *x = (const Part*)a, *y = (const Part*)b;
+    return (x->lo > y->lo) - (x->lo < y->lo);
+}
+
+static int cmd_combine(int nparts, char **paths) {
+    Part *parts = (Part*)calloc((size_t)nparts, sizeof(Part));
+    if (!parts) return 1;
+    for (int i = 0; i < nparts; i++) {
+        if (read_part(paths[i], &parts[i]) != 0) { free(parts); return 1; }
+    }
+
+    int errors = 0;
+    for (int i = 1; i < nparts; i++) {
+        if (parts[i].n != parts[0].n || parts[i].fingerprint != parts[0].fingerprint ||
+            parts[i].count != parts[0].count) {
+            fprintf(stderr, "%s: belongs to a different matrix than %s\n", parts[i].path, parts[0].path);
+            errors++;
+        }
+    }
+    if (errors) { free(parts); return 1; }
+
+    // Coverage: sorted ranges must tile [0, 2^(n-1)) without gaps or overlaps.
+    qsort(parts, (size_t)nparts, sizeof(Part), cmp_part_lo);
+    uint64_t total = 1ULL << (parts[0].n - 1), expect = 0;
+    for (int i = 0; i < nparts; i++) {
+        if (parts[i].lo > expect) {
+            fprintf(stderr, "missing range [%" PRIu64 ", %" PRIu64 ")\n", expect, parts[i].lo);
+            errors++;
+        } else if (parts[i].lo < expect) {
+            fprintf(stderr, "%s: range [%" PRIu64 ", %" PRIu64 ") overlaps previous parts\n",
+                    parts[i].path, parts[i].lo, parts[i].hi);
+            errors++;
+        }
+        if (parts[i].hi > expect) expect = parts[i].hi;
+    }
+    if (expect < total) {
+        fprintf(stderr, "missing range [%" PRIu64 ", %" PRIu64 ")\n", expect, total);
+        errors++;
+    }
+    if (errors) {
+        fprintf(stderr, "%d coverage error(s); rerun or remove the listed ranges\n", errors);
+        free(parts);
+        return 1;
+    }
+
+    // Sum the parts; permanent.c divides by 2^(n-1) and reconstructs by CRT.
+    int count = parts[0].count, n = parts[0].n;
+    uint64_t sum[PERM_MAX_RESIDUES];
+    for (int j = 0; j < count; j++) {
+        uint64_t p = permanent_residue_prime(j);
+        uint64_t s = 0;
+        for (int i = 0; i < nparts; i++) s = (s + parts[i].residues[j]) % p;
+        sum[j] = s;
+    }
+
+    char value[PERM_DECIMAL_MAX];
+    if (permanent_residue_decimal(sum, count, n, value, sizeof(value)) != 0) {
+        fprintf(stderr, "cannot reconstruct the permanent from %d residues\n", count);
+        free(parts);
+        return 1;
+    }
+    printf("n=%d, %d parts, %d residues\n", n, nparts, count);
+    printf("Permanent: %s\n", value);
+    free(parts);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 4 && strcmp(argv[1], "split") == 0) return cmd_split(argv[2], argv[3]);
+    if (argc == 6 && strcmp(argv[1], "run") == 0) return cmd_run(argv[2], argv[3], argv[4], argv[5]);
+    if (argc >= 3 && strcmp(argv[1], "combine") == 0) return cmd_combine(argc - 2, argv + 2);
+
+    fprintf(stderr,
+            "Usage:\n"
+            "  %s split   <matrix> <jobs>\n"
+            "  %s run     <matrix> <lo> <hi> <out>\n"
+            "  %s combine <part> [<part> ...]\n",
+            argv[0], argv[0], argv[0]);
+    return 2;
+}
@@ -0,0 +1,63 @@
+/*
+ * permanent_tune.c
+ * One-time tuning run for permanent_auto() on this machine.
+ *
+ * Times every permanent engine (Spies, ryser_new, permanent_ryser,
+ * multiplicity) at a small and a large size, fits ns per call and ns per
+ * unit of work, writes them to a tuning file and prints the resulting
+ * routing for dense random {-1,0,1} matrices of several shapes.
+ *
+ * Usage:
+ *   permanent_tune [file] [seconds]      default: permanent.tune, 2 seconds
+ *   export PERMANENT_TUNING=permanent.tune
+ *
+ * Dependencies: permanent.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "permanent.h"
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "permanent.tune";
+    double seconds = argc > 2 ? atof(argv[2]) : 2.0;
+
+    printf("--- permanent_auto tuning (kernels: %s) ---\n", permanent_isa());
+    if (permanent_calibrate(path, seconds) != 0) {
+        fprintf(stderr, "Calibration failed or %s not writable\n", path);
+        return 1;
+    }
+
+    FILE *fp = fopen(path, "r");
+    if (fp) {
+        char line[256];
+        while (fgets(line, sizeof(line), fp)) fputs(line, stdout);
+        fclose(fp);
+    }
+
+    static const int rows[] = { 2, 4, 8, 12, 16, 20 };
+    static const int cols[] = { 12, 16, 20, 24, 28 };
+    int8_t A[20 * 28];
+    uint64_t s = 0x9E3779B97F4A7C15ULL;
+
+    printf("\nRouting for dense random {-1,0,1} m x n matrices:\n%4s", "m\\n");
+    for (int j = 0; j < 5; j++) printf(" %13d", cols[j]);
+    printf("\n");
+    for (int i = 0; i < 6; i++) {
+        printf("%4d", rows[i]);
+        for (int j = 0; j < 5; j++) {
+            int m = rows[i], n = cols[j];
+            if (m > n) { printf(" %13s", "-"); continue; }
+            for (int k = 0; k < m * n; k++) {
+                s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+                A[k] = (int8_t)((s >> 32) % 3) - 1;
+                if (A[k] == 0) A[k] = 1;                  // no zeros: one block
+            }
+            printf(" %13s", permanent_auto_engine(A, m, n));
+        }
+        printf("\n");
+    }
+    printf("\nUse it with: export PERMANENT_TUNING=%s\n", path);
+    return 0;
+}
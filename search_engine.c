@@ -0,0 +1,357 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+#include "permanent.h"
+#include "search_engine.h"
+
+#define MAX_N 8
+#define EPSILON 1e-9
+
+// --- ENGINE STATE ---
+
+typedef struct {
+    long long *histogram;
+    long long matrices;
+    long long leaves;
+    long long singular;
+    SingularityStats cascade;
+    double perms[PIPE_BATCH];
+    double dets[PIPE_BATCH];
+} ThreadAcc;
+
+typedef struct {
+    const SearchSpec *spec;
+    int n;
+    int k;                  // alphabet size
+    int rows;               // k^n row patterns
+    int row_bits;           // bits per row index in a packed leaf
+    uint64_t row_mask;
+    int8_t *row_table;      // rows x n entries
+    int *row_weight;        // nonzeros per row
+    long long offset;
+    long long size;
+    ThreadAcc **acc;        // one per pipeline thread
+} Engine;
+
+// Digit <-> entry: binary 0,1; ternary 0,1,2 = 0,1,-1.
+static inline int8_t digit_entry(int k, int d) {
+    return (int8_t)((k == 3 && d == 2) ? -1 : d);
+}
+
+static inline int entry_digit(int8_t e) {
+    return e < 0 ? 2 : e;
+}
+
+const char *search_spec_error(const SearchSpec *spec) {
+    if (!spec) return "no spec";
+    if (spec->alphabet == ALPHABET_BINARY && (spec->n < 1 || spec->n > 8))
+        return "binary alphabet needs 1 <= n <= 8";
+    if (spec->alphabet == ALPHABET_TERNARY && (spec->n < 1 || spec->n > 6))
+        return "ternary alphabet needs 1 <= n <= 6";
+    if (spec->weight < -1 || spec->weight > spec->n * spec->n)
+        return "weight must be 'any' or in 0..n*n";
+    if (spec->enumerators < 1 || spec->evaluators < 0)
+        return "need at least one enumerator";
+    return NULL;
+}
+
+// --- RANK PRUNING (FLOATING POINT) ---
+// Heuristic (doubles, for speed): may pass rare dependent rows, which the
+// exact determinant at the leaf filters out.
+static int is_independent_real(double *basis, int current_rank, int n, const int8_t *row) {
+    double vec[MAX_N];
+    for (int i = 0; i < n; i++) vec[i] = (double)row[i];
+
+    for (int i = 0; i < current_rank; i++) {
+        int pivot_col = -1;
+        for (int c = 0; c < n; c++) {
+            if (fabs(basis[i * MAX_N + c]) > EPSILON) { pivot_col = c; break; }
+        }
+        if (pivot_col != -1 && fabs(vec[pivot_col]) > EPSILON) {
+            double factor = vec[pivot_col] / basis[i * MAX_N + pivot_col];
+            for (int c = pivot_col; c < n; c++) vec[c] -= factor * basis[i * MAX_N + c];
+        }
+    }
+
+    for (int c = 0; c < n; c++) {
+        if (fabs(vec[c]) > EPSILON) {
+            for (int b = 0; b < n; b++) basis[current_rank * MAX_N + b] = vec[b];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// --- ENUMERATORS ---
+
+// Weight bound: can 'w' after rows 0..row still reach the target?
+static inline int weight_ok(const Engine *E, int row, int w) {
+    int target = E->spec->weight;
+    if (target < 0) return 1;
+    if (row == E->n - 1) return w == target;
+    return w <= target && w + (E->n - 1 - row) * E->n >= target;
+}
+
+// Sorted rows (row indices non-decreasing, strictly increasing for nonsingular).
+static void dfs_sorted(const Engine *E, int row, int start, uint64_t packed, int weight,
+                       const double *basis, LeafEmitter *out) {
+    int strict = E->spec->det == DET_NONSINGULAR;
+    double next_basis[MAX_N * MAX_N];
+
+    for (int idx = start; idx < E->rows; idx++) {
+        int w = weight + E->row_weight[idx];
+        if (!weight_ok(E, row, w)) continue;
+        uint64_t next = packed | ((uint64_t)idx << (row * E->row_bits));
+
+        if (row == E->n - 1) {
+            pipeline_emit(out, next);
+            continue;
+        }
+        if (strict) {
+            memcpy(next_basis, basis, sizeof(next_basis));
+            if (!is_independent_real(next_basis, row, E->n, &E->row_table[(size_t)idx * E->n])) continue;
+        }
+        dfs_sorted(E, row + 1, strict ? idx + 1 : idx, next, w, next_basis, out);
+    }
+}
+
+// Symmetric matrices: row 'row' copies column 'row' of the rows above and
+// chooses only the entries on and right of the diagonal.
+static void dfs_symmetric(const Engine *E, int row, int8_t *M, uint64_t packed, int weight,
+                          LeafEmitter *out) {
+    int n = E->n, k = E->k;
+    int free_entries = n - row;
+    int combos = 1;
+    for (int i = 0; i < free_entries; i++) combos *= k;
+
+    for (int f = 0; f < combos; f++) {
+        int8_t *r = &M[row * MAX_N];
+        for (int c = 0, code = f; c < n; c++) {
+            if (c < row) r[c] = M[c * MAX_N + row];
+            else { r[c] = digit_entry(k, code % k); code /= k; }
+        }
+        int idx = 0;
+        for (int c = n - 1; c >= 0; c--) idx = idx * k + entry_digit(r[c]);
+
+        int w = weight + E->row_weight[idx];
+        if (!weight_ok(E, row, w)) continue;
+        uint64_t next = packed | ((uint64_t)idx << (row * E->row_bits));
+
+        if (row == n - 1) pipeline_emit(out, next);
+        else dfs_symmetric(E, row + 1, M, next, w, out);
+    }
+}
+
+// Task t fixes row 0 (index t for sorted rows, free-entry code t for symmetric).
+static void enumerate_task(int task, LeafEmitter *out, void *ctx) {
+    const Engine *E = (const Engine*)ctx;
+    const SearchSpec *spec = E->spec;
+
+    // values_only: a zero first row (task 0) only gives permanent 0, recorded up front.
+    if (spec->values_only && task == 0 && spec->det != DET_NONSINGULAR && spec->weight < 0) return;
+
+    if (spec->symmetry == SYMMETRY_SYMMETRIC) {
+        int8_t M[MAX_N * MAX_N];
+        int8_t *r = M;
+        for (int c = 0, code = task; c < E->n; c++) { r[c] = digit_entry(E->k, code % E->k); code /= E->k; }
+        int w = E->row_weight[task];
+        if (!weight_ok(E, 0, w)) return;
+        if (E->n == 1) pipeline_emit(out, (uint64_t)task);
+        else dfs_symmetric(E, 1, M, (uint64_t)task, w, out);
+        return;
+    }
+
+    int w = E->row_weight[task];
+    if (!weight_ok(E, 0, w)) return;
+    if (E->n == 1) { pipeline_emit(out, (uint64_t)task); return; }
+
+    double basis[MAX_N * MAX_N];
+    if (spec->det == DET_NONSINGULAR) {
+        memset(basis, 0, sizeof(basis));
+        if (!is_independent_real(basis, 0, E->n, &E->row_table[(size_t)task * E->n])) return;
+        dfs_sorted(E, 1, task + 1, (uint64_t)task, w, basis, out);
+    } else {
+        dfs_sorted(E, 1, task, (uint64_t)task, w, NULL, out);
+    }
+}
+
+// --- EVALUATOR ---
+
+// Ternary leaves: same parent sharing as permanent_det_packed, on row indices.
+static void evaluate_ternary(const Engine *E, const uint64_t *leaves, int count,
+                             double *perms, double *dets) {
+    int n = E->n, bits = E->row_bits;
+    uint64_t parent_mask = (n == 1) ? 0 : ((1ULL << (bits * (n - 1))) - 1);
+    int8_t A[MAX_N * MAX_N];
+    double pm[MAX_N], cf[MAX_N];
+
+    int i = 0;
+    while (i < count) {
+        uint64_t parent = leaves[i] & parent_mask;
+        int j = i + 1;
+        while (j < count && (leaves[j] & parent_mask) == parent) j++;
+
+        for (int r = 0; r < n - 1; r++) {
+            int idx = (int)((parent >> (r * bits)) & E->row_mask);
+            memcpy(&A[r * n], &E->row_table[(size_t)idx * n], (size_t)n);
+        }
+        laplace_last_row(A, n, pm, cf);
+
+        for (int v = i; v < j; v++) {
+            int idx = (int)((leaves[v] >> ((n - 1) * bits)) & E->row_mask);
+            const int8_t *x = &E->row_table[(size_t)idx * n];
+            double p = 0.0, d = 0.0;
+            for (int c = 0; c < n; c++) { p += x[c] * pm[c]; d += x[c] * cf[c]; }
+            perms[v] = p;
+            dets[v] = d;
+        }
+        i = j;
+    }
+}
+
+static void evaluate_batch(const LeafBatch *batch, int thread_id, void *ctx) {
+    const Engine *E = (const Engine*)ctx;
+    ThreadAcc *a = E->acc[thread_id];
+
+    if (E->k == 2) {
+        permanent_det_packed_stats(batch->leaf, batch->count, E->n, a->perms, a->dets, &a->cascade);
+    } else {
+        evaluate_ternary(E, batch->leaf, batch->count, a->perms, a->dets);
+        a->cascade.leaves += batch->count;
+        a->cascade.leaf_exact += batch->count;
+    }
+
+    SearchDetFilter det = E->spec->det;
+    for (int i = 0; i < batch->count; i++) {
+        a->singular += a->dets[i] == 0.0;
+        if (det == DET_SINGULAR && a->dets[i] != 0.0) continue;
+        if (det == DET_NONSINGULAR && a->dets[i] == 0.0) continue;
+        double p = a->perms[i];
+        long long v = (long long)(p < 0 ? p - 0.5 : p + 0.5);
+        a->histogram[v + E->offset]++;
+        a->matrices++;
+    }
+    a->leaves += batch->count;
+}
+
+// --- DRIVER ---
+
+int search_engine_run(const SearchSpec *spec, SearchResult *res) {
+    if (!res || search_spec_error(spec)) return -1;
+    memset(res, 0, sizeof(*res));
+
+    Engine E;
+    memset(&E, 0, sizeof(E));
+    E.spec = spec;
+    E.n = spec->n;
+    E.k = spec->alphabet == ALPHABET_TERNARY ? 3 : 2;
+    E.rows = 1;
+    for (int i = 0; i < E.n; i++) E.rows *= E.k;
+    if (E.k == 2) {
+        E.row_bits = 8;                 // permanent_det_packed layout
+    } else {
+        while ((1 << E.row_bits) < E.rows) E.row_bits++;
+    }
+    E.row_mask = (1ULL << E.row_bits) - 1;
+
+    long long fact = 1;
+    for (int i = 2; i <= E.n; i++) fact *= i;
+    E.offset = (E.k == 3) ? fact : 0;   // ternary permanents lie in [-n!, n!]
+    E.size = E.offset + fact + 1;
+
+    int nthreads = spec->enumerators + spec->evaluators;
+    E.row_table = (int8_t*)malloc((size_t)E.rows * E.n);
+    E.row_weight = (int*)malloc((size_t)E.rows * sizeof(int));
+    E.acc = (ThreadAcc**)calloc((size_t)nthreads, sizeof(ThreadAcc*));
+    res->leaf_histogram = (long long*)calloc((size_t)E.size, sizeof(long long));
+    int ok = E.row_table && E.row_weight && E.acc && res->leaf_histogram;
+    for (int t = 0; ok && t < nthreads; t++) {
+        E.acc[t] = (ThreadAcc*)calloc(1, sizeof(ThreadAcc));
+        ok = E.acc[t] && (E.acc[t]->histogram = (long long*)calloc((size_t)E.size, sizeof(long long)));
+    }
+
+    if (ok) {
+        for (int idx = 0; idx < E.rows; idx++) {
+            int w = 0;
+            for (int c = 0, code = idx; c < E.n; c++, code /= E.k) {
+                int8_t e = digit_entry(E.k, code % E.k);
+                E.row_table[(size_t)idx * E.n + c] = e;
+                w += e != 0;
+            }
+            E.row_weight[idx] = w;
+        }
+
+        PipelineConfig cfg;
+        memset(&cfg, 0, sizeof(cfg));
+        cfg.enumerators = spec->enumerators;
+        cfg.evaluators = spec->evaluators;
+        if (spec->symmetry == SYMMETRY_SYMMETRIC) cfg.tasks = E.rows;
+        else if (spec->det == DET_NONSINGULAR) cfg.tasks = E.rows - E.n + 1;  // room for n-1 larger rows
+        else cfg.tasks = E.rows;
+        cfg.enumerate = enumerate_task;
+        cfg.evaluate = evaluate_batch;
+        cfg.ctx = &E;
+        ok = pipeline_run(&cfg, &res->pipeline) == 0;
+    }
+
+    if (ok) {
+        res->offset = E.offset;
+        res->size = E.size;
+        for (int t = 0; t < nthreads; t++) {
+            for (long long v = 0; v < E.size; v++) res->leaf_histogram[v] += E.acc[t]->histogram[v];
+            res->matrices += E.acc[t]->matrices;
+            res->leaves += E.acc[t]->leaves;
+            res->singular += E.acc[t]->singular;
+            const SingularityStats *c = &E.acc[t]->cascade;
+            res->cascade.leaves += c->leaves;
+            res->cascade.parents += c->parents;
+            res->cascade.parent_structural += c->parent_structural;
+            res->cascade.parent_rank += c->parent_rank;
+            res->cascade.leaf_exact += c->leaf_exact;
+        }
+        if (spec->values_only && spec->det != DET_NONSINGULAR && spec->weight < 0 && E.n >= 1) {
+            res->leaf_histogram[E.offset]++;     // the skipped zero-first-row subtree
+        }
+    }
+
+    for (int t = 0; E.acc && t < nthreads; t++) {
+        if (E.acc[t]) free(E.acc[t]->histogram);
+        free(E.acc[t]);
+    }
+    free(E.acc);
+    free(E.row_table);
+    free(E.row_weight);
+    if (!ok) {
+        free(res->leaf_histogram);
+        res->leaf_histogram = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void search_result_free(SearchResult *res) {
+    if (!res) return;
+    free(res->leaf_histogram);
+    res->leaf_histogram = NULL;
+}
+
+void search_print_cascade(const SearchResult *res) {
+    const SingularityStats *c = &res->cascade;
+    double total = c->leaves > 0 ? (double)c->leaves : 1.0;
+    long long exact_singular = res->singular - c->parent_structural - c->parent_rank;
+    long long exact_nonsingular = c->leaf_exact - exact_singular;
+    printf("Singularity cascade: %lld leaves in %lld parent runs\n", c->leaves, c->parents);
+    printf("  Zero/repeated parent row: %14lld (%5.1f%%)\n", c->parent_structural,
+           100.0 * c->parent_structural / total);
+    printf("  Parent rank < n-1:        %14lld (%5.1f%%)\n", c->parent_rank,
+           100.0 * c->parent_rank / total);
+    printf("  Last row, det = 0:        %14lld (%5.1f%%)\n", exact_singular,
+           100.0 * exact_singular / total);
+    printf("  Last row, det != 0:       %14lld (%5.1f%%)\n", exact_nonsingular,
+           100.0 * exact_nonsingular / total);
+}
@@ -0,0 +1,68 @@
+#ifndef SEARCH_ENGINE_H
+#define SEARCH_ENGINE_H
+
+#include "permanent.h"
+#include "search_pipeline.h"
+
+/*
+ * Configurable enumeration engine for permanent-value sequences.
+ *
+ * One search = a matrix class (row alphabet + symmetry constraint), leaf
+ * predicates (determinant zero/nonzero, number of nonzero entries) and an
+ * aggregate over the permanents of the matrices that pass. The engine runs
+ * on the pipeline of search_pipeline.h and always collects the full
+ * histogram of permanent values over the enumerated leaves (one per sorted
+ * row multiset, or per symmetric matrix, not per matrix); sets, counts and
+ * min/max follow from it.
+ *
+ * Pruning is the same as in the dedicated searchers:
+ * - unconstrained classes: rows in sorted (non-decreasing) order;
+ * - nonsingular: strictly increasing rows plus real rank pruning;
+ * - weight: partial weights bounded by the target.
+ * Symmetric matrices are enumerated through their upper triangle.
+ *
+ * Leaves are packed into one uint64_t as row indices; binary rows use one
+ * byte each (the permanent_det_packed format). Limits: n <= 8 for binary,
+ * n <= 6 for ternary rows.
+ */
+
+typedef enum { ALPHABET_BINARY, ALPHABET_TERNARY } SearchAlphabet;     // {0,1} / {-1,0,1}
+typedef enum { SYMMETRY_NONE, SYMMETRY_SYMMETRIC } SearchSymmetry;
+typedef enum { DET_ANY, DET_SINGULAR, DET_NONSINGULAR } SearchDetFilter;
+
+typedef struct {
+    int n;
+    SearchAlphabet alphabet;
+    SearchSymmetry symmetry;
+    SearchDetFilter det;
+    int weight;             // exact number of nonzero entries, -1 = any
+    int values_only;        // only the value SET is needed: subtrees known to give
+                            // permanent 0 are skipped and value 0 is counted once
+    int enumerators;        // pipeline threads (>= 1)
+    int evaluators;         // >= 0
+} SearchSpec;
+
+typedef struct {
+    long long offset;       // leaf_histogram[v + offset] = number of leaves with permanent v:
+    long long size;         //   sorted row multisets (symmetric class: matrices), so a
+    long long *leaf_histogram;  // multiset counts once, however many row orders it has
+    long long matrices;     // leaves that passed all predicates (multisets, as above)
+    long long leaves;       // leaves evaluated
+    long long singular;     // leaves with det = 0 (before the predicate)
+    SingularityStats cascade;   // where det = 0 was settled (permanent_det_packed_stats);
+                                // ternary leaves all count as leaf_exact
+    PipelineStats pipeline;
+} SearchResult;
+
+// NULL if the spec is valid, otherwise a message describing the problem.
+const char *search_spec_error(const SearchSpec *spec);
+
+// Runs the search; returns 0 on success, -1 on an invalid spec or out of memory.
+int search_engine_run(const SearchSpec *spec, SearchResult *res);
+
+void search_result_free(SearchResult *res);
+
+// Prints the share of leaves settled at each stage of the singularity cascade.
+void search_print_cascade(const SearchResult *res);
+
+#endif
@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sched.h>
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+#include "search_pipeline.h"
+
+// --- LOCK-FREE MPMC RING (Vyukov) ---
+//
+// Every cell carries a sequence number: a producer may fill cell pos when
+// seq == pos, a consumer may take it when seq == pos + 1. Head and tail are
+// claimed with one CAS each; no locks, no allocation after setup.
+
+typedef struct {
+    _Atomic size_t seq;
+    LeafBatch *data;
+} RingCell;
+
+typedef struct {
+    RingCell *cells;
+    size_t mask;
+    _Alignas(64) _Atomic size_t head;
+    _Alignas(64) _Atomic size_t tail;
+} Ring;
+
+static int ring_init(Ring *q, size_t min_capacity) {
+    size_t cap = 2;
+    while (cap < min_capacity) cap <<= 1;
+    q->cells = (RingCell*)malloc(cap * sizeof(RingCell));
+    if (!q->cells) return -1;
+    for (size_t i = 0; i < cap; i++) {
+        atomic_init(&q->cells[i].seq, i);
+        q->cells[i].data = NULL;
+    }
+    q->mask = cap - 1;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    return 0;
+}
+
+static int ring_push(Ring *q, LeafBatch *b) {
+    size_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    for (;;) {
+        RingCell *cell = &q->cells[pos & q->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                cell->data = b;
+                atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+                return 0;
+            }
+        } else if (dif < 0) {
+            return -1;                                   // full
+        } else {
+            pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        }
+    }
+}
+
+static LeafBatch *ring_pop(Ring *q) {
+    size_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+    for (;;) {
+        RingCell *cell = &q->cells[pos & q->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                LeafBatch *b = cell->data;
+                atomic_store_explicit(&cell->seq, pos + q->mask + 1, memory_order_release);
+                return b;
+            }
+        } else if (dif < 0) {
+            return NULL;                                 // empty
+        } else {
+            pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+        }
+    }
+}
+
+static int ring_size(const Ring *q) {
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    return tail > head ? (int)(tail - head) : 0;
+}
+
+// --- PIPELINE ---
+
+typedef struct {
+    _Alignas(64) long long batches;
+    long long leaves;
+    long long producer_stalls;
+    long long consumer_stalls;
+    long long occupancy_sum;
+    long long occupancy_samples;
+    int occupancy_max;
+} ThreadStats;
+
+struct SearchPipeline {
+    const PipelineConfig *cfg;
+    Ring full;              // enumerators -> evaluators
+    Ring empty;             // evaluators -> enumerators
+    LeafBatch *pool;
+    ThreadStats *stats;
+    _Atomic int next_task;
+    _Atomic int enumerators_done;
+};
+
+int pipeline_queue_length(const SearchPipeline *pipe) {
+    return ring_size(&pipe->full);
+}
+
+// Evaluates one batch and hands it back to the enumerators.
+static void run_batch(SearchPipeline *pipe, LeafBatch *b, int tid) {
+    pipe->cfg->evaluate(b, tid, pipe->cfg->ctx);
+    pipe->stats[tid].batches++;
+    pipe->stats[tid].leaves += b->count;
+    b->count = 0;
+    ring_push(&pipe->empty, b);     // cannot fail: the ring holds every batch
+}
+
+// Next empty batch for enumerator 'tid'. If every batch is in flight the
+// evaluators are behind: evaluate a full one instead of waiting.
+static LeafBatch *acquire_batch(SearchPipeline *pipe, int tid) {
+    for (;;) {
+        LeafBatch *b = ring_pop(&pipe->empty);
+        if (b) return b;
+
+        pipe->stats[tid].producer_stalls++;
+        LeafBatch *f = ring_pop(&pipe->full);
+        if (f) run_batch(pipe, f, tid);
+        else sched_yield();
+    }
+}
+
+void pipeline_flush(LeafEmitter *e) {
+    SearchPipeline *pipe = e->pipe;
+    if (e->batch->count == 0) return;
+    ring_push(&pipe->full, e->batch);
+    e->batch = acquire_batch(pipe, e->thread_id);
+}
+
+static void evaluator_loop(SearchPipeline *pipe, int tid, int enumerators) {
+    ThreadStats *ts = &pipe->stats[tid];
+    for (;;) {
+        int waiting = ring_size(&pipe->full);
+        LeafBatch *b = ring_pop(&pipe->full);
+        if (b) {
+            ts->occupancy_sum += waiting;
+            ts->occupancy_samples++;
+            if (waiting > ts->occupancy_max) ts->occupancy_max = waiting;
+            run_batch(pipe, b, tid);
+            continue;
+        }
+        if (atomic_load_explicit(&pipe->enumerators_done, memory_order_acquire) == enumerators) {
+            // All leaves have been pushed; drain what is left.
+            b = ring_pop(&pipe->full);
+            if (!b) break;
+            run_batch(pipe, b, tid);
+            continue;
+        }
+        ts->consumer_stalls++;
+        sched_yield();
+    }
+}
+
+int pipeline_run(const PipelineConfig *cfg, PipelineStats *stats) {
+    if (!cfg || !cfg->enumerate || !cfg->evaluate) return -1;
+    if (cfg->enumerators < 1 || cfg->evaluators < 0 || cfg->tasks < 0) return -1;
+
+    int nthreads = cfg->enumerators + cfg->evaluators;
+    int queue_batches = cfg->queue_batches > 0 ? cfg->queue_batches : 4 * nthreads;
+    int total_batches = queue_batches + nthreads;
+
+    SearchPipeline pipe;
+    memset(&pipe, 0, sizeof(pipe));
+    pipe.cfg = cfg;
+    pipe.pool = (LeafBatch*)malloc((size_t)total_batches * sizeof(LeafBatch));
+    pipe.stats = (ThreadStats*)aligned_alloc(64, (size_t)nthreads * sizeof(ThreadStats));
+    if (pipe.stats) memset(pipe.stats, 0, (size_t)nthreads * sizeof(ThreadStats));
+    int ok = pipe.pool && pipe.stats &&
+             ring_init(&pipe.full, (size_t)total_batches) == 0;
+    ok = ok && ring_init(&pipe.empty, (size_t)total_batches) == 0;
+    if (!ok) {
+        free(pipe.pool); free(pipe.stats); free(pipe.full.cells); free(pipe.empty.cells);
+        return -1;
+    }
+    for (int i = 0; i < total_batches; i++) {
+        pipe.pool[i].count = 0;
+        ring_push(&pipe.empty, &pipe.pool[i]);
+    }
+    atomic_init(&pipe.next_task, 0);
+    atomic_init(&pipe.enumerators_done, 0);
+
+    #pragma omp parallel num_threads(nthreads)
+    {
+        int tid = 0, team = 1;
+#ifdef _OPENMP
+        tid = omp_get_thread_num();
+        team = omp_get_num_threads();
+#endif
+        // The runtime may give us fewer threads than asked for.
+        int enumerators = cfg->enumerators < team ? cfg->enumerators : team;
+
+        if (tid < enumerators) {
+            LeafEmitter e;
+            e.pipe = &pipe;
+            e.thread_id = tid;
+            // Enumerators that started earlier may already hold every empty batch.
+            e.batch = acquire_batch(&pipe, tid);
+            for (;;) {
+                int task = atomic_fetch_add(&pipe.next_task, 1);
+                if (task >= cfg->tasks) break;
+                cfg->enumerate(task, &e, cfg->ctx);
+            }
+            if (e.batch->count > 0) ring_push(&pipe.full, e.batch);
+            else ring_push(&pipe.empty, e.batch);
+            atomic_fetch_add_explicit(&pipe.enumerators_done, 1, memory_order_release);
+        }
+        // Enumerators that run out of tasks join the evaluators.
+        evaluator_loop(&pipe, tid, enumerators);
+    }
+
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+        long long occ_sum = 0, occ_samples = 0;
+        for (int t = 0; t < nthreads; t++) {
+            stats->batches += pipe.stats[t].batches;
+            stats->leaves += pipe.stats[t].leaves;
+            stats->producer_stalls += pipe.stats[t].producer_stalls;
+            stats->consumer_stalls += pipe.stats[t].consumer_stalls;
+            occ_sum += pipe.stats[t].occupancy_sum;
+            occ_samples += pipe.stats[t].occupancy_samples;
+            if (pipe.stats[t].occupancy_max > stats->max_occupancy)
+                stats->max_occupancy = pipe.stats[t].occupancy_max;
+        }
+        stats->mean_occupancy = occ_samples ? (double)occ_sum / (double)occ_samples : 0.0;
+        stats->capacity = total_batches;
+    }
+
+    free(pipe.pool);
+    free(pipe.stats);
+    free(pipe.full.cells);
+    free(pipe.empty.cells);
+    return 0;
+}
+
+void pipeline_print_stats(const PipelineConfig *cfg, const PipelineStats *s) {
+    printf("Pipeline: %d enumerators, %d evaluators, batch %d leaves\n",
+           cfg->enumerators, cfg->evaluators, PIPE_BATCH);
+    printf("  Batches: %lld (%lld leaves)\n", s->batches, s->leaves);
+    printf("  Queue occupancy: mean %.1f, max %d of %d batches\n",
+           s->mean_occupancy, s->max_occupancy, s->capacity);
+    printf("  Producer stalls (evaluators behind): %lld\n", s->producer_stalls);
+    printf("  Consumer stalls (enumerators behind): %lld\n", s->consumer_stalls);
+}
@@ -0,0 +1,81 @@
+#ifndef SEARCH_PIPELINE_H
+#define SEARCH_PIPELINE_H
+
+#include <stdint.h>
+
+/*
+ * Pipelined producer/consumer search engine.
+ *
+ * Enumerator threads walk the search tree and append leaves (bit-packed
+ * matrices, one uint64_t each) to fixed-size batches. Full batches go through
+ * a lock-free MPMC ring to evaluator threads, which run them through the
+ * batched kernels (e.g. permanent_det_packed) and update per-thread results.
+ * Drained batches return to the enumerators through a second ring.
+ *
+ * If no empty batch is available, an enumerator evaluates a full batch itself
+ * instead of waiting (counted as a producer stall), so any thread ratio makes
+ * progress. The statistics show which side is the bottleneck:
+ * - high occupancy / many producer stalls: add evaluators;
+ * - low occupancy / many consumer stalls: add enumerators.
+ */
+
+#define PIPE_BATCH 4096     // leaves per batch
+
+typedef struct {
+    int count;
+    uint64_t leaf[PIPE_BATCH];
+} LeafBatch;
+
+typedef struct SearchPipeline SearchPipeline;
+
+// Per-enumerator handle: the batch being filled.
+typedef struct {
+    SearchPipeline *pipe;
+    LeafBatch *batch;
+    int thread_id;
+} LeafEmitter;
+
+// enumerate(): expand root task 'task' and emit its leaves.
+// evaluate():  consume one batch; thread_id (0 .. enumerators+evaluators-1)
+//              selects the per-thread result slot.
+typedef void (*EnumerateFn)(int task, LeafEmitter *out, void *ctx);
+typedef void (*EvaluateFn)(const LeafBatch *batch, int thread_id, void *ctx);
+
+typedef struct {
+    int enumerators;        // >= 1
+    int evaluators;         // >= 0 (0: enumerators evaluate their own batches)
+    int tasks;              // root tasks 0 .. tasks-1, handed out dynamically
+    int queue_batches;      // batches in circulation besides the ones held by threads (0: default)
+    EnumerateFn enumerate;
+    EvaluateFn evaluate;
+    void *ctx;
+} PipelineConfig;
+
+typedef struct {
+    long long batches;          // batches evaluated
+    long long leaves;           // leaves evaluated
+    long long producer_stalls;  // no empty batch: an enumerator evaluated one itself
+    long long consumer_stalls;  // evaluator found the queue empty
+    double mean_occupancy;      // full batches waiting, averaged over evaluator pops
+    int max_occupancy;
+    int capacity;               // batches that can wait in the queue
+} PipelineStats;
+
+void pipeline_flush(LeafEmitter *e);
+
+static inline void pipeline_emit(LeafEmitter *e, uint64_t leaf) {
+    LeafBatch *b = e->batch;
+    b->leaf[b->count++] = leaf;
+    if (b->count == PIPE_BATCH) pipeline_flush(e);
+}
+
+// Full batches currently waiting for an evaluator.
+int pipeline_queue_length(const SearchPipeline *pipe);
+
+// Runs the whole search; returns 0 on success, -1 on invalid config or out of memory.
+int pipeline_run(const PipelineConfig *cfg, PipelineStats *stats);
+
+// Prints one line of queue statistics (to tune the enumerator/evaluator ratio).
+void pipeline_print_stats(const PipelineConfig *cfg, const PipelineStats *stats);
+
+#endif
@@ -1,7 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
 #include "permanent.h"
+#include "search_pipeline.h"
+#include "search_engine.h"
 
 
 static int failures = 0;
@@ -82,6 +87,44 @@ static long long perm_bruteforce(const int8_t *A, int m, int n) {
     return ctx.total;
 }
 
+/* --- exact permanent of a wide m x n matrix (small m): all injective column maps --- */
+
+static __int128 perm_exact_rows(const int8_t *A, int m, int n, int row, uint64_t used, __int128 prod) {
+    if (row == m) return prod;
+    __int128 total = 0;
+    for (int c = 0; c < n; c++) {
+        if ((used >> c) & 1 || A[row * n + c] == 0) continue;
+        total += perm_exact_rows(A, m, n, row + 1, used | (1ULL << c), prod * A[row * n + c]);
+    }
+    return total;
+}
+
+static double perm_exact_wide(const int8_t *A, int m, int n) {
+    return (double)perm_exact_rows(A, m, n, 0, 0, 1);
+}
+
+/* --- pipeline test: every task emits task*10 .. task*10+9 --- */
+
+static long long pipe_sums[16];
+
+static void pipe_enumerate(int task, LeafEmitter *out, void *ctx) {
+    (void)ctx;
+    for (int k = 0; k < 10000; k++) pipeline_emit(out, (uint64_t)task * 10000 + k);
+}
+
+static void pipe_evaluate(const LeafBatch *b, int thread_id, void *ctx) {
+    (void)ctx;
+    for (int i = 0; i < b->count; i++) pipe_sums[thread_id] += (long long)b->leaf[i];
+}
+
+/* --- wide entry types: deterministic test matrices --- */
+static void lcg_fill_i64(int64_t *out, int count, uint64_t seed, int64_t lo, int64_t hi) {
+    for (int i = 0; i < count; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        out[i] = lo + (int64_t)((seed >> 33) % (uint64_t)(hi - lo + 1));
+    }
+}
+
 int main(void) {
     printf("--- Test Suite: Permanent & Determinant ---\n");
     /* Edge cases / definitions */
@@ -181,6 +224,675 @@ int main(void) {
         }
     }
 
+    /* Repeated rows / columns: multiplicity-aware Ryser */
+    printf("\n--- Multiplicity-aware permanent ---\n");
+    {
+        /* 2 distinct rows, multiplicities 2 and 1, padded to 3x4 */
+        int8_t R[] = {1, 0, 1, 1,
+                      0, 1, 1, 1};
+        int mult[] = {2, 1};
+        int8_t A[] = {1, 0, 1, 1,
+                      1, 0, 1, 1,
+                      0, 1, 1, 1};
+        check_eq_d("permanent_multiplicity 3x4",
+                   permanent_multiplicity(R, mult, 2, 4), (double)perm_bruteforce(A, 3, 4));
+    }
+    {
+        /* 10x10 with three distinct rows: permanent() takes the multiplicity path */
+        int8_t A[10 * 10];
+        const int8_t rows[3][10] = {
+            {1, 1, 0, 1, 0, 1, 1, 0, 1, 1},
+            {0, 1, 1, 1, 1, 0, 1, 1, 0, 1},
+            {1, 0, 1, 0, 1, 1, 1, 1, 1, 0}
+        };
+        for (int r = 0; r < 10; r++)
+            for (int c = 0; c < 10; c++) A[r * 10 + c] = rows[r % 3][c];
+        check_eq_d("Repeated rows 10x10 (vs ryser_new)", permanent(A, 10, 10), ryser_new(A, 10, 10));
+
+        /* Same matrix transposed: repeated columns */
+        int8_t AT[10 * 10];
+        for (int r = 0; r < 10; r++)
+            for (int c = 0; c < 10; c++) AT[c * 10 + r] = A[r * 10 + c];
+        check_eq_d("Repeated columns 10x10 (vs ryser_new)", permanent(AT, 10, 10), ryser_new(A, 10, 10));
+    }
+    {
+        /* 3x11 rectangular: the 8 padding rows form one group */
+        int8_t C[3 * 11];
+        for (int i = 0; i < 3 * 11; i++) C[i] = (int8_t)((i * 7 + 3) % 5 - 2);
+        check_eq_d("Rectangular 3x11 (vs ryser2006)", permanent(C, 3, 11), permanent_ryser(C, 3, 11));
+    }
+    {
+        /* Wide rectangular inputs: the padding rows must not be grouped (the
+           multiplicity sum would cancel catastrophically and miss by orders of
+           magnitude). Padded Spies itself rounds slightly: within 0.5 or 1e-9. */
+        static const struct { int m, n; int64_t lo, hi; } wide[] = {
+            { 2, 30, 1, 127 }, { 4, 30, -1, 1 }, { 6, 20, -127, 127 }, { 3, 24, -127, 127 },
+        };
+        int8_t W[6 * 30];
+        int64_t v[6 * 30];
+        for (int t = 0; t < 4; t++) {
+            int m = wide[t].m, n = wide[t].n;
+            lcg_fill_i64(v, m * n, 101 + t, wide[t].lo, wide[t].hi);
+            for (int i = 0; i < m * n; i++) W[i] = (int8_t)v[i];
+            char label[64];
+            snprintf(label, sizeof(label), "Rectangular %dx%d entries [%lld,%lld] (vs exact)",
+                     m, n, (long long)wide[t].lo, (long long)wide[t].hi);
+            double exact = perm_exact_wide(W, m, n);
+            double got = permanent(W, m, n);
+            double tol = fabs(exact) * 1e-9 > 0.5 ? fabs(exact) * 1e-9 : 0.5;
+            check_eq_d(label, fabs(got - exact) < tol ? exact : got, exact);
+        }
+    }
+    {
+        /* Square, repeated rows (3 distinct rows of a 16x16): grouping would cost
+           ~1e-8 relative error here, so permanent() keeps Spies */
+        int8_t S[16 * 16];
+        int16_t S16[16 * 16];
+        int64_t v[3 * 16];
+        double worst = 0.0;
+        for (int t = 0; t < 8; t++) {
+            lcg_fill_i64(v, 3 * 16, 211 + t, -31, 31);
+            for (int i = 0; i < 16 * 16; i++) S16[i] = S[i] = (int8_t)v[(i / 16) % 3 * 16 + i % 16];
+            double exact = permanent_i16(S16, 16, 16);
+            double err = fabs(permanent(S, 16, 16) - exact) / (fabs(exact) > 1.0 ? fabs(exact) : 1.0);
+            if (err > worst) worst = err;
+        }
+        check_eq_d("Repeated rows 16x16 entries [-31,31]: relative error < 1e-11", worst < 1e-11, 1.0);
+    }
+
+    /* Laplace expansion along the last row */
+    printf("\n--- Last-row minors (laplace_last_row) ---\n");
+    {
+        int8_t A[5 * 5] = {
+            1, 0, 1, 1, 0,
+            0, 1, 1, 0, 1,
+            1, 1, 0, 1, 1,
+            1, 0, 0, 1, 1,
+            0, 0, 0, 0, 0      /* last row filled in below */
+        };
+        double pm[5], cof[5];
+        laplace_last_row(A, 5, pm, cof);
+        for (int val = 1; val < 32; val += 7) {
+            double p = 0.0, d = 0.0;
+            for (int b = 0; b < 5; b++) {
+                A[20 + b] = (int8_t)((val >> b) & 1);
+                p += A[20 + b] * pm[b];
+                d += A[20 + b] * cof[b];
+            }
+            char label[64];
+            snprintf(label, sizeof(label), "last row %d: permanent", val);
+            check_eq_d(label, p, permanent(A, 5, 5));
+            snprintf(label, sizeof(label), "last row %d: determinant", val);
+            check_eq_d(label, d, determinant(A, 5));
+        }
+    }
+
+    /* Stack minor buffer (n <= 9) and allocated one (n = 10): same expansion */
+    {
+        for (int n = 9; n <= 10; n++) {
+            int8_t A[10 * 10];
+            int64_t v[100];
+            lcg_fill_i64(v, n * n, 31 + n, -1, 1);
+            for (int i = 0; i < n * n; i++) A[i] = (int8_t)v[i];
+            double pm[10], cof[10], p = 0.0, d = 0.0;
+            laplace_last_row(A, n, pm, cof);
+            for (int c = 0; c < n; c++) {
+                p += A[(n - 1) * n + c] * pm[c];
+                d += A[(n - 1) * n + c] * cof[c];
+            }
+            char label[64];
+            snprintf(label, sizeof(label), "last row %dx%d: permanent", n, n);
+            check_eq_d(label, p, permanent(A, n, n));
+            snprintf(label, sizeof(label), "last row %dx%d: determinant", n, n);
+            check_eq_d(label, d, determinant(A, n));
+        }
+    }
+
+    /* Gray-code ranges: independent parts must add up to 2^(n-1) * perm */
+    printf("\n--- Partial Gray-code ranges (permanent_gray_range) ---\n");
+    {
+        int8_t A[8 * 8];
+        for (int i = 0; i < 8 * 8; i++) A[i] = (int8_t)((i * 11 + 4) % 7 - 3);
+        int count = permanent_residue_count(A, 8);
+        uint64_t p = permanent_residue_prime(0);
+        const uint64_t cuts[] = {0, 5, 77, 128};
+        uint64_t sum = 0, part[PERM_MAX_RESIDUES];
+        int rc = 0;
+        for (int k = 0; k < 3; k++) {
+            rc |= permanent_gray_range(A, 8, cuts[k], cuts[k + 1], count, part);
+            sum = (sum + part[0]) % p;
+        }
+        long long expected = (long long)permanent(A, 8, 8) * 128;
+        uint64_t expected_mod = expected < 0 ? p - (uint64_t)(-expected) % p : (uint64_t)expected % p;
+        check_eq_d("gray ranges status", (double)rc, 0.0);
+        check_eq_d("gray ranges residue count", (double)count, 1.0);
+        check_eq_d("gray ranges sum == 2^7 perm (mod p)", (double)(sum == expected_mod), 1.0);
+        check_eq_d("gray range beyond 2^(n-1) rejected",
+                   (double)permanent_gray_range(A, 8, 0, 129, count, part), -1.0);
+    }
+    {
+        /* Exact reconstruction beyond 2^64: row 0 negated in J_23 gives -23! */
+        int8_t A[23 * 23];
+        for (int i = 0; i < 23 * 23; i++) A[i] = i < 23 ? -1 : 1;
+        int count = permanent_residue_count(A, 23);
+        uint64_t sum[PERM_MAX_RESIDUES] = {0}, part[PERM_MAX_RESIDUES];
+        const uint64_t cuts[] = {0, 1000003, 1ULL << 22};
+        for (int k = 0; k < 2; k++) {
+            permanent_gray_range(A, 23, cuts[k], cuts[k + 1], count, part);
+            for (int j = 0; j < count; j++) sum[j] = (sum[j] + part[j]) % permanent_residue_prime(j);
+        }
+        char value[PERM_DECIMAL_MAX], small[8];
+        int rc = permanent_residue_decimal(sum, count, 23, value, sizeof(value));
+        check_eq_d("residue decimal: J_23 with row 0 negated == -23!",
+                   rc == 0 && strcmp(value, "-25852016738884976640000") == 0, 1.0);
+        check_eq_d("residue decimal: short buffer rejected",
+                   (double)permanent_residue_decimal(sum, count, 23, small, sizeof(small)), -1.0);
+    }
+
+    /* Bit-packed batches: row r in byte r */
+    printf("\n--- Packed batches (permanent_det_packed) ---\n");
+    {
+        uint64_t leaves[6];
+        int8_t M[6][4 * 4];
+        for (int k = 0; k < 6; k++) {
+            leaves[k] = 0;
+            for (int r = 0; r < 4; r++) {
+                /* first three leaves share rows 0..2 */
+                int v = (r < 3 && k < 3) ? (5 + 3 * r) % 16 : (k * 7 + r * 5 + 1) % 16;
+                leaves[k] |= (uint64_t)v << (8 * r);
+                for (int c = 0; c < 4; c++) M[k][r * 4 + c] = (int8_t)((v >> c) & 1);
+            }
+        }
+        double perms[6], dets[6];
+        permanent_det_packed(leaves, 6, 4, perms, dets);
+        int bad = 0;
+        for (int k = 0; k < 6; k++) {
+            if (perms[k] != permanent(M[k], 4, 4) || dets[k] != determinant(M[k], 4)) bad++;
+        }
+        check_eq_d("packed 4x4 batch mismatches", (double)bad, 0.0);
+    }
+
+    /* Singularity cascade: runs with a repeated, zero or dependent parent row */
+    {
+        static const int parents[4][3] = {{3, 5, 3}, {0, 6, 9}, {3, 4, 7}, {1, 2, 4}};
+        uint64_t leaves[4 * 16];
+        int8_t M[4 * 4];
+        int count = 0;
+        for (int p = 0; p < 4; p++)
+            for (int last = 0; last < 16; last++)
+                leaves[count++] = (uint64_t)parents[p][0] | (uint64_t)parents[p][1] << 8 |
+                                  (uint64_t)parents[p][2] << 16 | (uint64_t)last << 24;
+        double perms[4 * 16], dets[4 * 16];
+        SingularityStats st;
+        memset(&st, 0, sizeof(st));
+        permanent_det_packed_stats(leaves, count, 4, perms, dets, &st);
+        int bad = 0;
+        for (int k = 0; k < count; k++) {
+            for (int r = 0; r < 4; r++)
+                for (int c = 0; c < 4; c++) M[r * 4 + c] = (int8_t)((leaves[k] >> (8 * r + c)) & 1);
+            if (perms[k] != permanent(M, 4, 4) || dets[k] != determinant(M, 4)) bad++;
+        }
+        check_eq_d("cascade 4x4 mismatches", (double)bad, 0.0);
+        check_eq_d("cascade structural leaves", (double)st.parent_structural, 32.0);
+        check_eq_d("cascade rank leaves", (double)st.parent_rank, 16.0);
+        check_eq_d("cascade exact leaves", (double)st.leaf_exact, 16.0);
+    }
+
+    /* Pipeline: every leaf is evaluated exactly once, for any thread ratio */
+    printf("\n--- Search pipeline ---\n");
+    {
+        const int ratios[3][2] = {{1, 0}, {1, 2}, {3, 1}};
+        for (int k = 0; k < 3; k++) {
+            memset(pipe_sums, 0, sizeof(pipe_sums));
+            PipelineConfig cfg;
+            memset(&cfg, 0, sizeof(cfg));
+            cfg.enumerators = ratios[k][0];
+            cfg.evaluators = ratios[k][1];
+            cfg.tasks = 50;
+            cfg.queue_batches = 3;
+            cfg.enumerate = pipe_enumerate;
+            cfg.evaluate = pipe_evaluate;
+
+            PipelineStats st;
+            int rc = pipeline_run(&cfg, &st);
+            long long sum = 0;
+            for (int t = 0; t < 16; t++) sum += pipe_sums[t];
+
+            char label[64];
+            snprintf(label, sizeof(label), "pipeline %d+%d: leaves", cfg.enumerators, cfg.evaluators);
+            check_eq_d(label, rc == 0 ? (double)st.leaves : -1.0, 500000.0);
+            snprintf(label, sizeof(label), "pipeline %d+%d: checksum", cfg.enumerators, cfg.evaluators);
+            check_eq_d(label, (double)sum, 500000.0 * 499999.0 / 2.0);
+        }
+    }
+
+    /* Table-driven (0,1) kernel must agree with the Gray-code / Bareiss kernels */
+    printf("\n--- Table-driven (0,1) kernel ---\n");
+    {
+        uint64_t seed = 12345;
+        int8_t A[8 * 8];
+        for (int n = 1; n <= 8; n++) {
+            int bad_p = 0, bad_d = 0, bad_rect = 0, bad_minor = 0;
+            for (int trial = 0; trial < 200; trial++) {
+                for (int i = 0; i < n * n; i++) {
+                    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                    A[i] = (int8_t)((int)((seed >> 33) % 100) < 30 + 5 * n);
+                }
+                int m = 1 + trial % n;
+                double pm_t[8], cf_t[8], pm_g[8], cf_g[8];
+
+                permanent_set_tables(1);
+                double p_t = permanent(A, n, n), d_t = determinant(A, n), r_t = permanent(A, m, n);
+                laplace_last_row(A, n, pm_t, cf_t);
+                permanent_set_tables(0);
+                double p_g = permanent(A, n, n), d_g = determinant(A, n), r_g = permanent(A, m, n);
+                laplace_last_row(A, n, pm_g, cf_g);
+                permanent_set_tables(1);
+
+                bad_p += p_t != p_g;
+                bad_d += d_t != d_g;
+                bad_rect += r_t != r_g;
+                for (int j = 0; j < n; j++) bad_minor += pm_t[j] != pm_g[j] || cf_t[j] != cf_g[j];
+            }
+            char label[64];
+            snprintf(label, sizeof(label), "table %dx%d: permanent mismatches", n, n);
+            check_eq_d(label, (double)bad_p, 0.0);
+            snprintf(label, sizeof(label), "table %dx%d: determinant mismatches", n, n);
+            check_eq_d(label, (double)bad_d, 0.0);
+            snprintf(label, sizeof(label), "table mx%d: rectangular mismatches", n);
+            check_eq_d(label, (double)bad_rect, 0.0);
+            snprintf(label, sizeof(label), "table %dx%d: last-row minor mismatches", n, n);
+            check_eq_d(label, (double)bad_minor, 0.0);
+        }
+        int8_t J[8 * 8];
+        for (int i = 0; i < 64; i++) J[i] = 1;
+        check_eq_d("table: permanent(J_8) = 8!", permanent(J, 8, 8), 40320.0);
+        int8_t T[4] = {1, -1, 1, 1};
+        check_eq_d("table: (-1,0,1) input falls back", determinant(T, 2), 2.0);
+    }
+
+    /* Gradient: every minor permanent from one pass, vs permanent() per minor */
+    printf("\n--- Minor permanents (gradient) ---\n");
+    {
+        int8_t A[14 * 14], M[13 * 13];
+        double minors[14 * 14];
+        const int sizes[4] = {1, 3, 7, 14};
+        for (int k = 0; k < 4; k++) {
+            int n = sizes[k];
+            for (int i = 0; i < n * n; i++) A[i] = (int8_t)((i * 7 + 3) % 5 - 2);
+            double perm = permanent_minors(A, n, minors);
+            double err = 0.0, scale = 1.0;
+            for (int i = 0; i < n; i++) {
+                for (int j = 0; j < n; j++) {
+                    for (int r = 0, rr = 0; r < n; r++) {
+                        if (r == i) continue;
+                        for (int c = 0, cc = 0; c < n; c++) {
+                            if (c != j) M[rr * (n - 1) + cc++] = A[r * n + c];
+                        }
+                        rr++;
+                    }
+                    double want = permanent(M, n - 1, n - 1);
+                    if (fabs(want) > scale) scale = fabs(want);
+                    if (fabs(minors[i * n + j] - want) > err) err = fabs(minors[i * n + j] - want);
+                }
+            }
+            char label[64];
+            snprintf(label, sizeof(label), "minors %dx%d: max error / max minor", n, n);
+            check_eq_d(label, err / scale < 1e-12 ? 0.0 : err / scale, 0.0);
+            snprintf(label, sizeof(label), "minors %dx%d: returned permanent", n, n);
+            check_eq_d(label, perm, permanent(A, n, n));
+        }
+
+        // Double variant: d/da_ij perm of a diagonal-dominant matrix, vs the int8 variant.
+        double D[5 * 5], minors_d[5 * 5];
+        int8_t B[5 * 5];
+        for (int i = 0; i < 25; i++) { B[i] = (int8_t)(i % 6 == 0 ? 3 : (i % 3) - 1); D[i] = B[i]; }
+        double p8 = permanent_minors(B, 5, minors);
+        double pd = permanent_minors_d(D, 5, minors_d);
+        double diff = 0.0;
+        for (int i = 0; i < 25; i++) diff += fabs(minors[i] - minors_d[i]);
+        check_eq_d("minors double vs int8: permanent", pd, p8);
+        check_eq_d("minors double vs int8: sum |diff|", diff, 0.0);
+
+        double half[4] = {0.5, 0.25, 1.5, 2.0};      // perm = 1 + 0.375
+        pd = permanent_minors_d(half, 2, minors_d);
+        check_eq_d("minors double 2x2: permanent", pd, 1.375);
+        check_eq_d("minors double 2x2: d/da_01 = a_10", minors_d[1], 1.5);
+    }
+
+    /* Approximate permanent: bounds bracket the exact value, estimate within its interval */
+    printf("\n--- Approximate permanent ---\n");
+    {
+        PermanentApprox ap;
+        double J[10 * 10];
+        for (int i = 0; i < 100; i++) J[i] = 1.0;
+        int rc = permanent_approx(J, 10, 0.01, 0.95, 0, 1, &ap);
+        // All-ones: every sample is exactly 10!, so the estimate is exact.
+        check_eq_d("approx J_10: estimate", rc == 0 ? round(ap.estimate) : -1.0, 3628800.0);
+        check_eq_d("approx J_10: van der Waerden bound <= perm <= bound",
+                   ap.lower_bound <= 3628800.0 * (1 + 1e-9) && ap.upper_bound >= 3628800.0 * (1 - 1e-9), 1.0);
+
+        double R[12 * 12], minors[12 * 12];
+        uint64_t seed = 99;
+        for (int i = 0; i < 144; i++) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            R[i] = (double)(seed >> 11) * 0x1.0p-53;
+        }
+        double exact = permanent_minors_d(R, 12, minors);
+        rc = permanent_approx(R, 12, 0.01, 0.99, 0, 7, &ap);
+        check_eq_d("approx 12x12 uniform: converged", rc == 0 ? ap.converged : -1, 1.0);
+        check_eq_d("approx 12x12 uniform: |est - exact| <= 2 half-widths",
+                   fabs(ap.estimate - exact) <= 2.0 * ap.half_width, 1.0);
+        check_eq_d("approx 12x12 uniform: bounds bracket exact",
+                   ap.lower_bound <= exact && exact <= ap.upper_bound, 1.0);
+
+        // Large n: results in log form stay finite.
+        static double L[200 * 200];
+        for (int i = 0; i < 200 * 200; i++) L[i] = 1.0 + (i % 7) * 0.5;
+        rc = permanent_approx(L, 200, 0.05, 0.95, 200000, 3, &ap);
+        check_eq_d("approx 200x200: log bounds bracket log estimate",
+                   rc == 0 && ap.log_lower <= ap.log_estimate && ap.log_estimate <= ap.log_upper, 1.0);
+
+        double Z[9] = {1, 2, 3, 0, 0, 0, 4, 5, 6};
+        rc = permanent_approx(Z, 3, 0.01, 0.95, 0, 1, &ap);
+        check_eq_d("approx zero row: exactly 0", rc == 0 ? ap.estimate : -1.0, 0.0);
+        // No zero line, but no perfect matching either: exact 0, finite bounds, no sampling.
+        double D[9] = {1, 1, 1, 1, 0, 0, 1, 0, 0};
+        rc = permanent_approx(D, 3, 0.01, 0.95, 0, 1, &ap);
+        check_eq_d("approx no matching: exactly 0", rc == 0 ? ap.estimate : -1.0, 0.0);
+        check_eq_d("approx no matching: converged, no samples, bounds 0",
+                   ap.converged == 1 && ap.samples == 0 && ap.lower_bound == 0.0 && ap.upper_bound == 0.0, 1.0);
+
+        // No total support (upper triangular ones, perm = 1): Sinkhorn does not
+        // converge, so the bounds must come from row/column sums and stay valid.
+        double U[8 * 8];
+        for (int i = 0; i < 8; i++) for (int j = 0; j < 8; j++) U[i * 8 + j] = j >= i;
+        rc = permanent_approx(U, 8, 0.01, 0.95, 100000, 1, &ap);
+        check_eq_d("approx upper triangular: |est - 1| <= 2 half-widths",
+                   rc == 0 && fabs(ap.estimate - 1.0) <= 2.0 * ap.half_width, 1.0);
+        check_eq_d("approx upper triangular: finite bounds bracket 1",
+                   isfinite(ap.upper_bound) && ap.lower_bound <= 1.0 && ap.upper_bound >= 1.0, 1.0);
+        double N2[4] = {1, -1, 1, 1};
+        check_eq_d("approx negative entry rejected", permanent_approx(N2, 2, 0.01, 0.95, 0, 1, &ap), -1.0);
+    }
+
+    /* Wide entry types: exact results (reference values from exact integer arithmetic) */
+    printf("\n--- int16 / int32 entries ---\n");
+    {
+        int64_t v[64];
+        int16_t S[64];
+        int32_t L[64];
+
+        // 4x4 int16 in [-1000, 1000]: int64 accumulators
+        lcg_fill_i64(v, 16, 1, -1000, 1000);
+        for (int i = 0; i < 16; i++) S[i] = (int16_t)v[i];
+        check_eq_d("i16 4x4: permanent (int64)", permanent_i16(S, 4, 4), 940701967920.0);
+        check_eq_d("i16 4x4: ryser_new", ryser_new_i16(S, 4, 4), 940701967920.0);
+        check_eq_d("i16 4x4: determinant (int64)", determinant_i16(S, 4), -239886519344.0);
+
+        // 3x3 / 6x6 int16 in [-30000, 30000]: __int128 / modular
+        lcg_fill_i64(v, 9, 6, -30000, 30000);
+        for (int i = 0; i < 9; i++) S[i] = (int16_t)v[i];
+        check_eq_d("i16 3x3: determinant (int128)", determinant_i16(S, 3), -8648422060506.0);
+        lcg_fill_i64(v, 36, 2, -30000, 30000);
+        for (int i = 0; i < 36; i++) S[i] = (int16_t)v[i];
+        check_eq_d("i16 6x6: permanent (int128)", permanent_i16(S, 6, 6), -4.4191605482144804e+23);
+        check_eq_d("i16 6x6: ryser_new", ryser_new_i16(S, 6, 6), -4.4191605482144804e+23);
+        check_eq_d("i16 6x6: determinant (modular)", determinant_i16(S, 6), 1.83972132576175e+26);
+
+        // 8x8 int16 near the limits: modular
+        lcg_fill_i64(v, 64, 5, -32767, 32767);
+        for (int i = 0; i < 64; i++) S[i] = (int16_t)v[i];
+        check_eq_d("i16 8x8: permanent (modular)", permanent_i16(S, 8, 8), -4.389270724793042e+34);
+        check_eq_d("i16 8x8: determinant (modular)", determinant_i16(S, 8), 1.5271964386480173e+37);
+
+        // int32 near the limits, square and rectangular
+        lcg_fill_i64(v, 25, 3, -2147483647, 2147483647);
+        for (int i = 0; i < 25; i++) L[i] = (int32_t)v[i];
+        check_eq_d("i32 5x5: permanent (modular)", permanent_i32(L, 5, 5), -9.428549146399844e+46);
+        check_eq_d("i32 5x5: ryser_new", ryser_new_i32(L, 5, 5), -9.428549146399844e+46);
+        check_eq_d("i32 5x5: determinant (modular)", determinant_i32(L, 5), -8.809142955615373e+44);
+        lcg_fill_i64(v, 15, 4, -1073741824, 1073741824);
+        for (int i = 0; i < 15; i++) L[i] = (int32_t)v[i];
+        check_eq_d("i32 3x5: permanent", permanent_i32(L, 3, 5), -3.0448040250462344e+27);
+        check_eq_d("i32 3x5: ryser_new", ryser_new_i32(L, 3, 5), -3.0448040250462344e+27);
+
+        // Small entries: same results as the int8 functions
+        int8_t B[49];
+        int bad = 0;
+        for (int trial = 0; trial < 20; trial++) {
+            int n = 1 + trial % 7, m = 1 + (trial * 3) % n;
+            lcg_fill_i64(v, n * n, 100 + trial, -3, 3);
+            for (int i = 0; i < n * n; i++) { B[i] = (int8_t)v[i]; S[i] = (int16_t)v[i]; L[i] = (int32_t)v[i]; }
+            bad += permanent_i16(S, m, n) != permanent(B, m, n);
+            bad += permanent_i32(L, m, n) != permanent(B, m, n);
+            bad += ryser_new_i32(L, m, n) != ryser_new(B, m, n);
+            bad += determinant_i16(S, n) != determinant(B, n);
+            bad += determinant_i32(L, n) != determinant(B, n);
+        }
+        check_eq_d("i16/i32 vs int8 on small entries: mismatches", (double)bad, 0.0);
+    }
+
+    /* Automatic engine selection: reductions, routing, tuning files */
+    printf("\n--- permanent_auto ---\n");
+    {
+        int8_t A[30 * 30];
+        int64_t v[30 * 30];
+        char label[96];
+
+        // Random {-1,0,1} and (0,1) shapes against brute force
+        int bad = 0;
+        for (int trial = 0; trial < 40; trial++) {
+            int n = 2 + trial % 7, m = 1 + (trial * 5) % n;
+            lcg_fill_i64(v, m * n, 200 + trial, trial & 1 ? -1 : 0, 1);
+            for (int i = 0; i < m * n; i++) A[i] = (int8_t)v[i];
+            bad += permanent_auto(A, m, n) != (double)perm_bruteforce(A, m, n);
+        }
+        check_eq_d("auto vs brute force (40 random shapes): mismatches", (double)bad, 0.0);
+
+        // Direct sum of two 5x5 blocks, rows and columns shuffled
+        int8_t P[10 * 10], Q[10 * 10];
+        lcg_fill_i64(v, 50, 7, -2, 2);
+        memset(P, 0, sizeof(P));
+        for (int i = 0; i < 5; i++)
+            for (int j = 0; j < 5; j++) {
+                P[i * 10 + j] = (int8_t)v[i * 5 + j];
+                P[(i + 5) * 10 + j + 5] = (int8_t)v[25 + i * 5 + j];
+            }
+        int8_t B1[25], B2[25];
+        for (int i = 0; i < 5; i++)
+            for (int j = 0; j < 5; j++) { B1[i * 5 + j] = P[i * 10 + j]; B2[i * 5 + j] = P[(i + 5) * 10 + j + 5]; }
+        for (int i = 0; i < 10; i++)
+            for (int j = 0; j < 10; j++) Q[((i * 3) % 10) * 10 + (j * 7) % 10] = P[i * 10 + j];
+        check_eq_d("auto direct sum 10x10 = product of blocks", permanent_auto(Q, 10, 10),
+                   permanent(B1, 5, 5) * permanent(B2, 5, 5));
+
+        // Generalized permutation matrix: settled by the reductions alone
+        memset(A, 0, 12 * 12);
+        double expect = 1.0;
+        for (int i = 0; i < 12; i++) { A[i * 12 + (i * 5) % 12] = (int8_t)(i % 3 + 1); expect *= i % 3 + 1; }
+        check_eq_d("auto generalized permutation 12x12", permanent_auto(A, 12, 12), expect);
+        check_eq_d("auto generalized permutation: engine structural",
+                   strcmp(permanent_auto_engine(A, 12, 12), "structural") == 0, 1.0);
+        A[0] = 0;                                  // row 0 now zero
+        check_eq_d("auto zero row: 0", permanent_auto(A, 12, 12), 0.0);
+
+        // 16x16 (0,1) with five distinct rows of weight 4, repeated 4,3,3,3,3 times:
+        // 1280 multiplicity terms instead of 2^15, and exact in double
+        static const int group[16] = { 0, 0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4 };
+        memset(A, 0, 16 * 16);
+        for (int r = 0; r < 16; r++)
+            for (int k = 0; k < 4; k++)
+                A[r * 16 + (group[r] < 4 ? 4 * group[r] + k : 2 + 4 * k)] = 1;
+        snprintf(label, sizeof(label), "auto 16x16 repeated rows: engine %s", permanent_auto_engine(A, 16, 16));
+        check_eq_d(label, strcmp(permanent_auto_engine(A, 16, 16), "multiplicity") == 0, 1.0);
+        check_eq_d("auto 16x16 repeated rows: value", permanent_auto(A, 16, 16), ryser_new(A, 16, 16));
+
+        // Wide rectangular: no padding, Ryser over small subsets
+        lcg_fill_i64(v, 4 * 30, 13, -1, 1);
+        for (int i = 0; i < 4 * 30; i++) A[i] = (int8_t)(v[i] ? v[i] : 1);
+        snprintf(label, sizeof(label), "auto 4x30: engine %s", permanent_auto_engine(A, 4, 30));
+        check_eq_d(label, strcmp(permanent_auto_engine(A, 4, 30), "ryser") == 0, 1.0);
+        check_eq_d("auto 4x30: value", permanent_auto(A, 4, 30), permanent_ryser(A, 4, 30));
+
+        // Tuning file: calibrate, save, reload; malformed files are rejected
+        char tune[] = "/tmp/permanent_test_XXXXXX";
+        int fd = mkstemp(tune);
+        if (fd >= 0) close(fd);
+        check_eq_d("calibrate + save", fd >= 0 ? permanent_calibrate(tune, 0.2) : -1.0, 0.0);
+        check_eq_d("load saved tuning", permanent_load_tuning(tune), 0.0);
+
+        // No engine is exact for 24x24 with entries 100 (Spies: 270 bits, multiplicity
+        // over the 25 row groups: 294). Spies wins at its real cost, but not once
+        // it costs more than 2^24 times as much.
+        static int8_t H[24 * 24];
+        memset(H, 100, sizeof(H));
+        check_eq_d("auto 24x24 inexact: smaller bound (spies)",
+                   strcmp(permanent_auto_engine(H, 24, 24), "spies") == 0, 1.0);
+        char slow[] = "/tmp/permanent_test_XXXXXX";
+        fd = mkstemp(slow);
+        FILE *fp = fd >= 0 ? fdopen(fd, "w") : NULL;
+        if (fp) { fprintf(fp, "spies 1e15 0.58\n"); fclose(fp); }
+        check_eq_d("load slow spies tuning", fp ? permanent_load_tuning(slow) : -1.0, 0.0);
+        check_eq_d("auto 24x24 inexact: spies 10^9 times slower -> multiplicity",
+                   strcmp(permanent_auto_engine(H, 24, 24), "multiplicity") == 0, 1.0);
+        check_eq_d("reload saved tuning", permanent_load_tuning(tune), 0.0);
+        remove(slow);
+        fp = fopen(tune, "w");
+        if (fp) { fprintf(fp, "spies 100 0.5\nwarp_drive 1 1\n"); fclose(fp); }
+        check_eq_d("load rejects unknown engine", permanent_load_tuning(tune), -1.0);
+        check_eq_d("load missing file", permanent_load_tuning("/nonexistent/permanent.tune"), -1.0);
+        remove(tune);
+    }
+
+    /* Search engine: A089475/A089476 terms at n=4 and a ternary histogram */
+    printf("\n--- Search engine ---\n");
+    {
+        SearchSpec spec;
+        memset(&spec, 0, sizeof(spec));
+        spec.n = 4;
+        spec.weight = -1;
+        spec.enumerators = 1;
+        spec.evaluators = 1;
+        SearchResult res;
+        long long distinct;
+
+        spec.det = DET_NONSINGULAR;
+        int rc = search_engine_run(&spec, &res);
+        distinct = 0;
+        for (long long i = 0; rc == 0 && i < res.size; i++) distinct += res.leaf_histogram[i] != 0;
+        check_eq_d("engine nonsingular 4x4: distinct (A089475)", rc == 0 ? (double)distinct : -1.0, 9.0);
+        check_eq_d("engine nonsingular 4x4: matrices", rc == 0 ? (double)res.matrices : -1.0, 940.0);
+        search_result_free(&res);
+
+        spec.det = DET_SINGULAR;
+        spec.values_only = 1;
+        rc = search_engine_run(&spec, &res);
+        distinct = 0;
+        for (long long i = 0; rc == 0 && i < res.size; i++) distinct += res.leaf_histogram[i] != 0;
+        check_eq_d("engine singular 4x4: distinct (A089476)", rc == 0 ? (double)distinct : -1.0, 10.0);
+        check_eq_d("engine singular 4x4: cascade covers every singular leaf",
+                   rc == 0 && res.cascade.leaves == res.leaves && res.singular == res.matrices &&
+                   res.cascade.parent_structural + res.cascade.parent_rank <= res.singular, 1.0);
+        search_result_free(&res);
+
+        // All 3x3 (-1,0,1) row multisets: C(29,3) leaves, permanents symmetric about 0.
+        spec.n = 3;
+        spec.alphabet = ALPHABET_TERNARY;
+        spec.det = DET_ANY;
+        spec.values_only = 0;
+        rc = search_engine_run(&spec, &res);
+        check_eq_d("engine ternary 3x3: leaves", rc == 0 ? (double)res.leaves : -1.0, 3654.0);
+        check_eq_d("engine ternary 3x3: permanent 6 count",
+                   rc == 0 ? (double)res.leaf_histogram[res.offset + 6] : -1.0, 8.0);
+        search_result_free(&res);
+
+        spec.alphabet = ALPHABET_BINARY;
+        spec.n = 9;
+        check_eq_d("engine rejects binary n=9", search_engine_run(&spec, &res), -1.0);
+    }
+
+    /* Every kernel variant the CPU supports must give the same results */
+    printf("\n--- Runtime ISA dispatch (default: %s) ---\n", permanent_isa());
+    {
+        const char *default_isa = permanent_isa();
+        const char *isas[] = {"generic", "avx2", "avx512"};
+        int8_t A[9 * 9];
+        for (int i = 0; i < 9 * 9; i++) A[i] = (int8_t)((i * 5 + 1) % 4 - 1);
+        double pm[4] = {1, 2, 3, 4}, cf[4] = {-1, 1, -2, 2};
+
+        /* Generic results as the reference for the batched kernels: packed
+           leaves (runs of 8 sharing the first n-1 rows), row values over all
+           256 last rows, and all minors of 9x9 and 13x13 matrices */
+        uint64_t leaves[2][64];
+        double ref_pk[2][2][64], ref_rv[2][256], ref_mn[9 * 9 + 13 * 13], ref_mp[2];
+        double wpm[8], wcf[8];
+        int8_t B[13 * 13];
+        int pk_n[2] = {6, 8};
+        for (int t = 0; t < 2; t++) {
+            int64_t rows[64];
+            lcg_fill_i64(rows, 64, 301 + t, 0, (1 << pk_n[t]) - 1);
+            for (int i = 0; i < 64; i++) {
+                leaves[t][i] = 0;
+                for (int r = 0; r < pk_n[t] - 1; r++)
+                    leaves[t][i] |= (uint64_t)rows[(i / 8 * 7 + r) % 64] << (8 * r);
+                leaves[t][i] |= (uint64_t)rows[i] << (8 * (pk_n[t] - 1));
+            }
+        }
+        for (int j = 0; j < 8; j++) {
+            wpm[j] = (double)(j * 37 % 11);
+            wcf[j] = (double)(j * 13 % 9) - 4;
+        }
+        for (int i = 0; i < 13 * 13; i++) B[i] = (int8_t)((i * 7 + 3) % 5 - 2);
+        permanent_set_isa("generic");
+        for (int t = 0; t < 2; t++) permanent_det_packed(leaves[t], 64, pk_n[t], ref_pk[t][0], ref_pk[t][1]);
+        laplace_row_values(wpm, wcf, 8, 0, 256, ref_rv[0], ref_rv[1]);
+        ref_mp[0] = permanent_minors(A, 9, ref_mn);
+        ref_mp[1] = permanent_minors(B, 13, ref_mn + 9 * 9);
+
+        for (int k = 0; k < 3; k++) {
+            if (permanent_set_isa(isas[k]) != 0) {
+                printf("SKIP: %s not supported\n", isas[k]);
+                continue;
+            }
+            char label[64];
+            snprintf(label, sizeof(label), "%s: permanent 6x9 (vs brute)", isas[k]);
+            check_eq_d(label, permanent(A, 6, 9), (double)perm_bruteforce(A, 6, 9));
+            snprintf(label, sizeof(label), "%s: ryser_new 6x9 (vs brute)", isas[k]);
+            check_eq_d(label, ryser_new(A, 6, 9), (double)perm_bruteforce(A, 6, 9));
+            snprintf(label, sizeof(label), "%s: determinant 2x2", isas[k]);
+            int8_t D[] = {2, 1, 1, 3};
+            check_eq_d(label, determinant(D, 2), 5.0);
+
+            double perms[16], dets[16];
+            laplace_row_values(pm, cf, 4, 0, 16, perms, dets);
+            snprintf(label, sizeof(label), "%s: row values (val=13)", isas[k]);
+            check_eq_d(label, perms[13] * 100 + dets[13], 8 * 100 - 1);
+
+            double got[2][256], mn[9 * 9 + 13 * 13], diff = 0.0;
+            for (int t = 0; t < 2; t++) {
+                permanent_det_packed(leaves[t], 64, pk_n[t], got[0], got[1]);
+                for (int i = 0; i < 64; i++)
+                    diff += fabs(got[0][i] - ref_pk[t][0][i]) + fabs(got[1][i] - ref_pk[t][1][i]);
+            }
+            snprintf(label, sizeof(label), "%s: det_packed n=6,8 (vs generic)", isas[k]);
+            check_eq_d(label, diff, 0.0);
+
+            diff = 0.0;
+            laplace_row_values(wpm, wcf, 8, 0, 256, got[0], got[1]);
+            for (int i = 0; i < 256; i++) diff += fabs(got[0][i] - ref_rv[0][i]) + fabs(got[1][i] - ref_rv[1][i]);
+            snprintf(label, sizeof(label), "%s: row values n=8 (vs generic)", isas[k]);
+            check_eq_d(label, diff, 0.0);
+
+            diff = fabs(permanent_minors(A, 9, mn) - ref_mp[0]) +
+                   fabs(permanent_minors(B, 13, mn + 9 * 9) - ref_mp[1]);
+            for (int i = 0; i < 9 * 9 + 13 * 13; i++) diff += fabs(mn[i] - ref_mn[i]);
+            snprintf(label, sizeof(label), "%s: minors 9x9, 13x13 (vs generic)", isas[k]);
+            check_eq_d(label, diff, 0.0);
+        }
+        permanent_set_isa(default_isa);
+    }
+
     printf("\nSummary: %s (%d failures)\n", failures ? "FAIL" : "PASS", failures);
     return failures ? 1 : 0;
 }